@@ -4,11 +4,52 @@
 #include <sstream>
 #include <string>
 #include <limits>       // Required for numeric_limits
-#include <algorithm>    // Required for std::sort and std::remove_if
-#include <stdexcept>    // Required for std::runtime_error, std::invalid_argument, std::out_of_range
+#include <algorithm>    // Required for std::sort
 #include <iomanip>      // Required for std::fixed and std::setprecision
-#include <ctime>        // Required for time()
-#include <cstdlib>      // Required for srand() and rand()
+#include <chrono>       // Required for std::chrono::steady_clock
+#include <random>       // Required for std::random_device
+#include <cstring>      // Required for memchr()
+#include <string_view>  // Required for std::string_view
+#include <charconv>     // Required for std::from_chars
+#include <thread>       // Required for std::thread
+#include <functional>   // Required for std::hash
+#include <cstdint>      // Required for uint32_t
+#include <cstdio>       // Required for std::remove
+#include <filesystem>   // Required for std::filesystem::rename
+#include <map>          // Required for std::map
+#include <deque>        // Required for std::deque
+#include <unordered_map> // Required for std::unordered_map
+#include <set>          // Required for std::set
+#include <unordered_set> // Required for std::unordered_set
+#include <type_traits>  // Required for std::is_integral
+#include <cmath>        // Required for std::llround, std::sqrt and std::isfinite
+#include <mutex>        // Required for std::mutex
+#include <shared_mutex> // Required for std::shared_mutex
+#include <condition_variable> // Required for std::condition_variable
+#include <atomic>       // Required for std::atomic
+#include <array>        // Required for std::array
+#include <csignal>      // Required for std::signal
+#include <cstdlib>      // Required for std::exit
+
+// AVX2 statistics kernels are compiled with a target attribute and picked at
+// run time, so the program still runs on CPUs without AVX2.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS 1
+#include <immintrin.h>  // Required for AVX2 intrinsics
+#endif
+
+#ifdef _WIN32
+#include <windows.h>    // Required for CreateFileMapping() and MapViewOfFile()
+#else
+#include <fcntl.h>      // Required for open()
+#include <sys/mman.h>   // Required for mmap() and munmap()
+#include <sys/stat.h>   // Required for fstat()
+#include <unistd.h>     // Required for close()
+#include <sys/socket.h> // Required for socket(), accept() and send()
+#include <sys/un.h>     // Required for sockaddr_un
+#include <poll.h>       // Required for poll()
+#include <cerrno>       // Required for errno
+#endif
 
 using namespace std;
 
@@ -21,12 +62,13 @@ struct Student {
     string address;
     string bloodGroup;
     string studentID; // Unique ID
-    string admittedCourse; // The course student is admitted to
-    string admissionType; // "KCET" or "Management"
+    uint16_t courseId; // The course student is admitted to (see courseNames)
+    uint16_t admissionTypeId; // ADMISSION_KCET or ADMISSION_MANAGEMENT (see admissionTypes)
     double totalMarks;
     int rankObtained;
     double expectedPackage; // in Lakhs per annum
     double feesPaid;
+    bool deleted = false; // Tombstone: keeps its ID, rank and marks until compactStudentSlots()
 };
 
 struct Course {
@@ -35,48 +77,840 @@ struct Course {
     double managementFees;
 };
 
+// Interns strings as dense small integer IDs. Used for course names and
+// admission types so each Student stores two uint16_t values instead of two
+// strings, and comparisons become integer compares. Names live in a deque so
+// the string_view keys stay valid as the dictionary grows.
+class StringDictionary {
+public:
+    static constexpr uint16_t NOT_FOUND = UINT16_MAX;
+
+    StringDictionary() = default;
+    StringDictionary(const StringDictionary&) = delete; // Keys point into names_, a copy would dangle
+    StringDictionary& operator=(const StringDictionary&) = delete;
+    StringDictionary(StringDictionary&&) = default;
+    StringDictionary(initializer_list<const char*> initial) {
+        for (const char* text : initial) intern(text);
+    }
+
+    uint16_t intern(string_view text) {
+        auto it = ids_.find(text);
+        if (it != ids_.end()) return it->second;
+        // IDs are stored in uint16_t and NOT_FOUND is reserved, so a 65536th
+        // name cannot be represented. Real data has a handful of courses and
+        // types; callers report the row as having too many distinct values.
+        if (names_.size() >= NOT_FOUND) return NOT_FOUND;
+        uint16_t id = static_cast<uint16_t>(names_.size());
+        names_.emplace_back(text);
+        ids_.emplace(names_.back(), id);
+        return id;
+    }
+    uint16_t find(string_view text) const {
+        auto it = ids_.find(text);
+        return it == ids_.end() ? NOT_FOUND : it->second;
+    }
+    const string& name(uint16_t id) const { return names_[id]; }
+    size_t size() const { return names_.size(); }
+
+private:
+    deque<string> names_;
+    unordered_map<string_view, uint16_t> ids_;
+};
+
+const uint16_t ADMISSION_KCET = 0;
+const uint16_t ADMISSION_MANAGEMENT = 1;
+const uint16_t ANY_COURSE = StringDictionary::NOT_FOUND; // Range scans: no course filter
+const size_t SEARCH_RESULT_LIMIT = 20; // Matches shown for a name/email search
+
+// Read-only memory mapping of a whole file. The loader tokenizes the mapped
+// bytes in place instead of copying every line into a stringstream.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const string& path);
+    void close();
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+};
+
+// Walks the lines of a mapped file in order, without their "\n" or "\r\n"
+// ending, and numbers them for error reports
+class LineReader {
+public:
+    explicit LineReader(const MappedFile& file) : cursor_(file.data()), end_(file.data() + file.size()) {}
+
+    bool next(string_view& line);
+    size_t lineNumber() const { return lineNumber_; } // Of the line next() returned last
+
+private:
+    const char* cursor_;
+    const char* end_;
+    size_t lineNumber_ = 0;
+};
+
+// One line of students.txt split into fields that still point into the mapping.
+// Strings are only copied out when the whole row has parsed cleanly.
+const int STUDENT_FIELD_COUNT = 12;
+const int MAX_CSV_FIELDS = 32; // Fields kept per record; legacy rows with unquoted commas need more than 12
+const char* const COURSE_FIELD_NAMES[] = {"courseName", "kcetFees", "managementFees"};
+const char* const STUDENT_FIELD_NAMES[STUDENT_FIELD_COUNT] = {
+    "name", "phoneNumber", "email", "address", "bloodGroup", "studentID",
+    "admittedCourse", "admissionType", "totalMarks", "rankObtained", "expectedPackage", "feesPaid"};
+
+struct StudentRowView {
+    string_view fields[STUDENT_FIELD_COUNT];
+    string unquoted[STUDENT_FIELD_COUNT]; // Backing for quoted fields that contained doubled quotes
+    double totalMarks;
+    int rankObtained;
+    double expectedPackage;
+    double feesPaid;
+};
+
+// Where the CSV tokenizer is relative to quoted fields: outside one, inside
+// one, or just past a quote inside one (which closes it unless another quote
+// follows, making a doubled quote)
+enum class CsvQuoteState : uint8_t { Outside, Inside, JustClosed };
+
+// Why one field of a line could not be parsed
+enum class FieldStatus : uint8_t { Ok, Missing, Invalid, OutOfRange, TooMany, Unknown, Repeated, TooManyValues };
+
+// Which field of a row failed and how
+struct RowError {
+    int field = 0;
+    FieldStatus status = FieldStatus::Ok;
+};
+
+// Problems found while loading a file, grouped by field and kind so that a
+// file with thousands of bad lines still produces a few lines of output.
+// Each group keeps its count, its first few line numbers and one sample line.
+class ParseErrorReport {
+public:
+    void add(const RowError& error, size_t line, string_view text);
+    void merge(const ParseErrorReport& other, size_t lineOffset);
+    size_t total() const { return total_; }
+    void print(ostream& out, const string& path, const char* const fieldNames[]) const;
+
+private:
+    static const size_t SAMPLE_LINES = 5;
+    struct Group {
+        RowError error;
+        size_t count = 0;
+        vector<size_t> lines;
+        string sample;
+    };
+    Group& group(const RowError& error);
+
+    vector<Group> groups_; // In order of first occurrence; only a handful ever exist
+    size_t total_ = 0;
+};
+
+// What one loader worker produced from its newline-aligned slice of the file.
+// Errors keep their chunk-local line number until the chunks are merged.
+struct StudentChunkResult {
+    vector<Student> students;
+    ParseErrorReport errors;
+    size_t lineCount = 0;            // Physical lines, counting those inside quoted fields
+    StringDictionary courseNames;    // IDs in students refer to these until merged
+    StringDictionary admissionTypes;
+};
+
+// Open-addressing hash index from a string field (studentID, phone number or
+// email) to the slot of the first student holding it. Only slots are stored;
+// keys are read back from the records themselves, so the index costs 8 bytes
+// per bucket. Empty keys are not indexed. Deletes use backward shifting, no
+// tombstones. Later holders of a key (legacy data) are kept aside, so one of
+// them takes the key over when the indexed holder is erased. An optional
+// normalizer maps keys that mean the same contact to one form before hashing
+// and comparing; records keep the value as entered.
+class StudentKeyIndex {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+    // Returns key in normal form, using scratch only when it differs from key
+    using KeyNormalizer = string_view (*)(string_view key, string& scratch);
+
+    StudentKeyIndex(const vector<Student>& records, string Student::*field, KeyNormalizer normalize = nullptr)
+        : records_(records), field_(field), normalize_(normalize) {}
+
+    uint32_t find(string_view key) const;
+    bool insert(uint32_t slot);          // false if another record already holds the key
+    void erase(uint32_t slot);           // Must run before the record changes, the key is read from it
+    // Re-indexes every live record; onDuplicate gets each one whose key was taken
+    void rebuild(const function<void(uint32_t)>& onDuplicate);
+
+private:
+    struct Bucket {
+        uint32_t slot = NOT_FOUND;
+        uint32_t hash = 0;
+    };
+
+    static uint32_t hashKey(string_view key) { return static_cast<uint32_t>(std::hash<string_view>()(key)); }
+    string_view normalKey(string_view key, string& scratch) const { return normalize_ ? normalize_(key, scratch) : key; }
+    string_view recordKey(uint32_t slot, string& scratch) const { return normalKey(records_[slot].*field_, scratch); }
+    size_t probe(string_view key, uint32_t hash) const; // Bucket holding the normal-form key, or the empty bucket ending its run
+    void grow();
+
+    const vector<Student>& records_;
+    string Student::*field_;
+    KeyNormalizer normalize_;
+    vector<Bucket> buckets_;
+    size_t used_ = 0;
+    unordered_multimap<uint32_t, uint32_t> duplicates_; // Key hash -> slots whose key another slot holds
+};
+
+string_view normalizePhoneKey(string_view key, string& scratch);
+string_view normalizeEmailKey(string_view key, string& scratch);
+
+// Search-as-you-type over name and email. Every distinct lowercase trigram of
+// a student's name and email maps to the slots containing it, and the first
+// one, two and three characters of the name get postings of their own for
+// prefix lookups. Postings are append-only: erase() only counts entries as
+// stale, searches verify every candidate against the record, and the
+// postings are rebuilt once stale entries outnumber live ones.
+class TextSearchIndex {
+public:
+    explicit TextSearchIndex(const vector<Student>& records) : records_(records) {}
+
+    void insert(uint32_t slot);
+    void erase(uint32_t slot);           // Must run before the record changes
+    void clear();
+    void remap(const vector<uint32_t>& newSlot); // Renumbers slots after compaction, dropping NOT_FOUND ones
+    // Name-prefix matches first, then name/email substring matches (queries
+    // of three or more characters), each slot at most once
+    size_t search(string_view query, size_t limit, const function<void(uint32_t)>& visit) const;
+
+private:
+    static void collectGrams(const Student& s, vector<uint32_t>& out);
+    void addPostings(uint32_t slot);
+    void compactPostings(uint32_t skipSlot);
+
+    const vector<Student>& records_;
+    unordered_map<uint32_t, vector<uint32_t>> postings_;
+    size_t postingCount_ = 0;
+    size_t livePostings_ = 0;
+    vector<uint32_t> scratch_;
+};
+
+// Binary columnar snapshot (students.snap). Layout, all little-endian:
+//   SnapshotHeader
+//   SnapshotColumnEntry[columnCount]   byte range of each column, 8-byte aligned
+//   column data
+// Numeric columns are raw arrays of rowCount values. String columns are
+// rowCount + 1 uint64 offsets followed by the concatenated bytes.
+const char SNAPSHOT_MAGIC[8] = {'U', 'G', 'C', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+enum SnapshotColumn : uint32_t {
+    COL_NAME, COL_PHONE, COL_EMAIL, COL_ADDRESS, COL_BLOOD_GROUP, COL_STUDENT_ID,
+    COL_COURSE, COL_ADMISSION_TYPE, // String columns
+    COL_TOTAL_MARKS, COL_RANK, COL_PACKAGE, COL_FEES, // Numeric columns
+    SNAPSHOT_COLUMN_COUNT
+};
+const uint32_t SNAPSHOT_STRING_COLUMNS = COL_TOTAL_MARKS;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t columnCount; // Readers ignore columns they do not know about
+    uint64_t rowCount;
+};
+
+struct SnapshotColumnEntry {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Read-only view over a mapped snapshot. Opening only validates the header and
+// column bounds; every value is read straight out of the mapping.
+class StudentSnapshot {
+public:
+    bool open(const string& path, string& error);
+    size_t rowCount() const { return rowCount_; }
+    string_view text(SnapshotColumn column, size_t row) const {
+        const uint64_t* offsets = stringOffsets_[column];
+        return string_view(stringData_[column] + offsets[row], offsets[row + 1] - offsets[row]);
+    }
+    const double* totalMarks() const { return totalMarks_; }
+    const int32_t* rankObtained() const { return rankObtained_; }
+    const double* expectedPackage() const { return expectedPackage_; }
+    const double* feesPaid() const { return feesPaid_; }
+    Student materialize(size_t row, StringDictionary& courseDictionary, StringDictionary& typeDictionary) const;
+
+private:
+    MappedFile file_;
+    size_t rowCount_ = 0;
+    const uint64_t* stringOffsets_[SNAPSHOT_STRING_COLUMNS] = {};
+    const char* stringData_[SNAPSHOT_STRING_COLUMNS] = {};
+    const double* totalMarks_ = nullptr;
+    const int32_t* rankObtained_ = nullptr;
+    const double* expectedPackage_ = nullptr;
+    const double* feesPaid_ = nullptr;
+};
+
+enum class SnapshotFormat { Csv, Binary, Sharded };
+
+// One per-course file of the sharded store (see Sharded Storage)
+struct StudentShard {
+    string course;
+    string file;       // Inside SHARD_DIRECTORY
+    uint64_t rows = 0; // Students in the file when it was last written
+    bool loaded = false;
+};
+
+// splitmix64 generator. Small and fast enough to give every sample-generation
+// thread its own stream without sharing state.
+struct FastRandom {
+    uint64_t state;
+
+    explicit FastRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform value in [0, bound)
+    uint32_t below(uint32_t bound) { return static_cast<uint32_t>(((next() >> 32) * bound) >> 32); }
+};
+
+// Secondary index key: students are ordered by rank, ties broken by student ID
+// so every record has a stable position (and page cursors survive edits).
+struct RankKey {
+    int rankObtained;
+    string_view studentID;
+};
+
+// Orders student slots by (rank, ID), reading both from the records, so the
+// index itself only stores 4-byte slots.
+struct RankOrder {
+    using is_transparent = void;
+    bool operator()(uint32_t a, uint32_t b) const;
+    bool operator()(uint32_t a, const RankKey& b) const;
+    bool operator()(const RankKey& a, uint32_t b) const;
+};
+
+// Same idea for total marks: ascending marks, ties broken by student ID
+struct MarksKey {
+    double totalMarks;
+    string_view studentID;
+};
+
+struct MarksOrder {
+    using is_transparent = void;
+    bool operator()(uint32_t a, uint32_t b) const;
+    bool operator()(uint32_t a, const MarksKey& b) const;
+    bool operator()(const MarksKey& a, uint32_t b) const;
+};
+
+// Count and fee total for one group of students. Fees are kept in paise so
+// adding and removing the same student always cancels exactly.
+struct AggregateCell {
+    int64_t count = 0;
+    int64_t feesPaise = 0;
+};
+
+// Group-by totals maintained on every add, update and delete, so statistics
+// are read in O(1) instead of rescanning all students.
+class AdmissionAggregates {
+public:
+    void add(const Student& s) { apply(s, 1); }
+    void remove(const Student& s) { apply(s, -1); }
+    void clear();
+
+    AggregateCell byType(uint16_t admissionTypeId) const { return cell(byType_, admissionTypeId); }
+    AggregateCell byCourse(uint16_t courseId) const { return cell(byCourse_, courseId); }
+    AggregateCell byCourseAndType(uint16_t courseId, uint16_t admissionTypeId) const {
+        return courseId < byCourseType_.size() ? cell(byCourseType_[courseId], admissionTypeId) : AggregateCell();
+    }
+    const map<string, int64_t>& bloodGroupCounts() const { return bloodGroups_; }
+
+private:
+    void apply(const Student& s, int direction);
+    static void bump(vector<AggregateCell>& cells, size_t index, int direction, int64_t feesPaise);
+    static AggregateCell cell(const vector<AggregateCell>& cells, size_t index) {
+        return index < cells.size() ? cells[index] : AggregateCell();
+    }
+
+    vector<AggregateCell> byType_;                 // Indexed by admissionTypeId
+    vector<AggregateCell> byCourse_;               // Indexed by courseId
+    vector<vector<AggregateCell>> byCourseType_;   // [courseId][admissionTypeId]
+    map<string, int64_t> bloodGroups_;
+};
+
+// Column copies of the Student fields that get scanned in bulk. Rebuilt on
+// demand when storeVersion shows the records have changed.
+struct StudentColumns {
+    uint64_t version = UINT64_MAX;
+    vector<double> totalMarks;
+    vector<double> expectedPackage;
+    vector<double> feesPaid;
+    vector<int32_t> rankObtained;
+    vector<uint16_t> courseId;
+    vector<uint16_t> admissionTypeId;
+    vector<uint32_t> slot; // Student slot of each row; tombstoned slots have no row
+};
+
+// Result of one pass over a numeric column
+struct ColumnScan {
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+};
+
+const int HISTOGRAM_BINS = 10;
+const double REPORTED_PERCENTILES[] = {25, 50, 75, 90, 99};
+
+struct ColumnStatistics {
+    size_t count = 0;
+    double mean = 0, min = 0, max = 0, stddev = 0;
+    double percentiles[sizeof(REPORTED_PERCENTILES) / sizeof(REPORTED_PERCENTILES[0])] = {};
+    size_t histogram[HISTOGRAM_BINS] = {};
+};
+
+// Columns a query can filter or sort on (see the Query Engine section)
+enum class QueryField : uint8_t { Course, Type, Marks, Rank, Package, Fees };
+enum class QueryOp : uint8_t { Eq, Ne, Lt, Le, Gt, Ge };
+
+// One "<field> <op> <value>" term of a query
+struct QueryPredicate {
+    QueryField field = QueryField::Marks;
+    QueryOp op = QueryOp::Eq;
+    double number = 0; // Numeric fields
+    string text;       // course and type; resolved to a dictionary ID when the query runs
+};
+
+// A parsed query: the AND of its predicates, then an optional order and limit
+struct QueryPlan {
+    vector<QueryPredicate> predicates;
+    bool ordered = false;
+    QueryField orderBy = QueryField::Rank;
+    bool descending = false;
+    size_t limit = SIZE_MAX;
+};
+
+// Seat allocation (see the Counselling section). Seats, fills and cutoffs are
+// indexed by courseId * QUOTA_COUNT + quota, the quota being the candidate's
+// admission type.
+const size_t QUOTA_COUNT = 2; // ADMISSION_KCET and ADMISSION_MANAGEMENT
+
+struct CounsellingCandidate {
+    int32_t rank;
+    double marks;              // Breaks rank ties: higher marks choose first
+    uint32_t student;          // Caller's identifier, a slot in students
+    uint16_t quota;
+    uint16_t preferenceCount;
+    uint32_t firstPreference;  // Offset into CounsellingInput::preferences
+};
+
+struct CounsellingInput {
+    vector<uint32_t> seats;             // Per course x quota
+    vector<CounsellingCandidate> candidates;
+    vector<uint16_t> preferences;       // Course IDs; each candidate's run in order of choice
+};
+
+struct CounsellingResult {
+    vector<uint16_t> allottedCourse;    // Per candidate; StringDictionary::NOT_FOUND if none
+    vector<uint16_t> allottedChoice;    // 1 for the first preference, 0 if none
+    vector<uint32_t> filled;            // Per course x quota
+    vector<int32_t> closingRank;        // Per course x quota; rank of the last seat filled, 0 if none
+    size_t allotted = 0;
+};
+
+// A student whose feesPaid differs from what the course table charges now
+struct FeeMismatch {
+    uint32_t slot;
+    int64_t expectedPaise; // UNPRICED_FEES when the course is no longer offered or the type is not a quota
+};
+
+// Change data capture stream (students.cdc) for downstream systems. Layout,
+// all little-endian: CDC_MAGIC, then one event per change:
+//   uint32 size       bytes that follow, checksum included
+//   uint64 sequence   1, 2, 3, ... in the order the changes were made
+//   uint8  op         'A' add, 'U' update, 'D' delete (also one per student
+//                     of a withdrawn course), 'W' course withdrawn (only in
+//                     streams written before withdrawals sent D events)
+//   payload           A/U: studentID, name, phone, email, address, blood
+//                     group, course and admission type, each a uint32 length
+//                     and bytes, then totalMarks, expectedPackage and feesPaid
+//                     (double) and rankObtained (int32).
+//                     D: the student ID; W: the course name (length + bytes).
+//   uint32 checksum   FNV-1a of sequence, op and payload
+// An event is appended only once its change is on disk (journal or
+// snapshot), so a consumer never sees a change that a crash could undo.
+// Events whose write fails are kept and written before any newer ones, so
+// the sequence never skips a number.
+const char CDC_MAGIC[8] = {'U', 'G', 'C', 'C', 'D', 'C', '1', '\0'};
+const int CDC_TEXT_FIELDS = 8;
+
+// One decoded event; the text fields point into the caller's buffer
+struct ChangeEvent {
+    uint64_t sequence = 0;
+    char op = 0;
+    string_view text[CDC_TEXT_FIELDS]; // D and W only use text[0]
+    double totalMarks = 0;
+    double expectedPackage = 0;
+    double feesPaid = 0;
+    int32_t rankObtained = 0;
+};
+
+// Every method but encode() and lastSequence() needs journalWriter.fileLock().
+class ChangeStream {
+public:
+    string encode(char op, const Student& s);  // Assigns the next sequence number
+    string encode(char op, string_view key);
+    // Appends events after any that earlier writes could not, and fsyncs.
+    // On failure everything unwritten is kept for the next call.
+    bool write(const string& events);
+    bool hasUnwritten();
+    uint64_t lastSequence();                   // Last one handed out; at startup, the last in students.cdc
+    static uint64_t firstSequence(const string& events); // Of the first encoded event, 0 if there is none
+
+    // A snapshot's events are staged in students.cdc.pending before it is
+    // written (see compactStudentStore). stage() writes queued and an op
+    // event for each of slots there; it refuses while older events are
+    // still unwritten. After the snapshot: publishStaged(), or dropStaged()
+    // if it failed, which also takes back the sequence numbers of slots.
+    bool stage(const string& queued, char op, const vector<uint32_t>& slots);
+    bool publishStaged();
+    void dropStaged();
+    // At startup: publishes what a crash left staged if isLoaded says the
+    // records hold the last change of every student and course it names,
+    // that is, the snapshot was saved. Otherwise drops it.
+    void recoverStaged(const function<bool(const ChangeEvent&)>& isLoaded);
+
+private:
+    void open();                               // Finds the last sequence, dropping a torn tail
+    bool flush();                              // Writes the staged file, then unwritten_
+    bool append(const char* data, size_t size);
+    string begin(char op);
+    static string encodeStudent(uint64_t sequence, char op, const Student& s);
+    static void finish(string& event);
+
+    mutex lock_;
+    bool opened_ = false;
+    bool disabled_ = false;                    // students.cdc is not a change stream or cannot be opened
+    uint64_t lastSequence_ = 0;
+    uint64_t stagedFrom_ = 0;                  // lastSequence_ before stage() numbered its slots
+    bool staged_ = false;                      // students.cdc.pending holds the oldest unwritten events
+    string unwritten_;                         // Newer events whose write failed, in sequence order
+    size_t size_ = 0;                          // Bytes of students.cdc known to be complete
+    ofstream out_;
+};
+
+// Group-commit writer for students.journal (see the Background Writer section)
+class JournalWriter {
+public:
+    ~JournalWriter() { stop(); }
+
+    void append(string line, string events); // Queues a journal line with its change events and returns at once
+    void stop();                // Commits everything queued and joins the thread
+    string queuedEvents();      // Change events of the queued lines, for ChangeStream::stage()
+    bool hasQueued();           // Lines are waiting to be committed
+    void discardQueued();       // Queued lines are covered by a snapshot just written, their events staged
+    bool runningOnThisThread() const;
+    mutex& fileLock() { return fileLock_; } // Held while the journal file is written or truncated
+
+private:
+    void run();
+    bool commit(const vector<string>& batch, uint64_t firstSequence);
+    void compactIfDue(bool force);
+
+    mutex queueLock_;
+    condition_variable wake_;
+    vector<string> queue_;
+    string events_;             // Change events of the queued lines, published once they are committed
+    bool stopping_ = false;
+    bool compactNow_ = false;   // The journal could not be written, save a snapshot instead
+    thread thread_;
+    mutex fileLock_;
+    chrono::milliseconds interval_{0};
+    size_t batchEntries_ = 0;
+};
+
+// Where a rank-ordered page query left off
+struct RankPageCursor {
+    bool started = false;
+    int rankObtained = 0;
+    string studentID;
+};
+
+// Collects formatted text in one large buffer and writes it to the stream in
+// big chunks. Never flushes the underlying stream by itself, and formats
+// numbers with to_chars instead of iostream manipulators.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(ostream& out, size_t capacity = 1 << 20) : out_(out), capacity_(capacity) {
+        buffer_.reserve(capacity);
+    }
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+    ~OutputBuffer() { flush(); }
+
+    OutputBuffer& operator<<(string_view text) {
+        if (buffer_.size() + text.size() > capacity_) flush();
+        buffer_.append(text.data(), text.size());
+        return *this;
+    }
+    OutputBuffer& operator<<(char c) {
+        if (buffer_.size() + 1 > capacity_) flush();
+        buffer_.push_back(c);
+        return *this;
+    }
+    template <typename T, typename = enable_if_t<is_integral_v<T>>>
+    OutputBuffer& operator<<(T value) {
+        char digits[24];
+        auto result = to_chars(digits, digits + sizeof(digits), value);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+    // Fixed-point with the given number of decimals, like fixed << setprecision(n)
+    // Room for DBL_MAX in fixed notation (309 digits and a sign) plus the
+    // decimals; anything that still does not fit is printed in scientific
+    OutputBuffer& fixed(double value, int decimals = 2) {
+        char digits[400];
+        auto result = to_chars(digits, digits + sizeof(digits), value, chars_format::fixed, decimals);
+        if (result.ec != errc()) result = to_chars(digits, digits + sizeof(digits), value, chars_format::scientific, decimals);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+    void flush() {
+        if (buffer_.empty()) return;
+        out_.write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+private:
+    ostream& out_;
+    size_t capacity_;
+    string buffer_;
+};
+
 // --- Global Variables ---
-vector<Student> students;
+vector<Student> students; // May contain tombstones, see removeStudentRecord()
+size_t deadStudentCount = 0; // Tombstoned slots in students
+StudentKeyIndex studentIndex(students, &Student::studentID);
+StudentKeyIndex phoneIndex(students, &Student::phoneNumber, normalizePhoneKey); // Enforces unique phone numbers on add and update
+StudentKeyIndex emailIndex(students, &Student::email, normalizeEmailKey);
+set<uint32_t, RankOrder> rankIndex; // Every slot, in rank order; tombstones stay until compaction
+set<uint32_t, MarksOrder> marksIndex; // Every slot, in ascending order of total marks; likewise
+TextSearchIndex textIndex(students);
+AdmissionAggregates admissionAggregates;
+uint64_t storeVersion = 0; // Bumped on every record change, invalidates cached columns
+StudentColumns columnCache;
+mutex columnCacheMutex; // Concurrent readers may race to rebuild columnCache
+mutex allotmentFileMutex; // Concurrent "allot" commands may write the same allotment file
+mutex exportFileMutex; // Likewise for concurrent "export" commands and their file
+shared_mutex storeMutex; // Server mode: shared for queries, exclusive for changes
 vector<Course> courses;
+StringDictionary courseNames; // Every course name seen, offered or not
+StringDictionary admissionTypes{"KCET", "Management"}; // Matches ADMISSION_KCET and ADMISSION_MANAGEMENT
+vector<int> courseSlotById; // courseNames ID -> index in courses, or -1 if no longer offered
 const string STUDENTS_FILE = "students.txt";
 const string COURSES_FILE = "courses.txt";
+const string ID_COUNTER_FILE = "student_ids.txt"; // Next free student number, so deleted IDs are never reused
+const string SNAPSHOT_FILE = "students.snap"; // Binary alternative to students.txt, used when present
+const string SHARD_DIRECTORY = "students.shards"; // One snapshot per course, used when its manifest exists
+const string SHARD_MANIFEST = "manifest.txt";
+const string SEAT_MATRIX_FILE = "seats.txt";        // <course>,<KCET seats>,<Management seats>
+const string PREFERENCES_FILE = "preferences.txt"; // <student ID>,<first choice course>,<second>,...
+const string ALLOTMENT_FILE = "allotment.txt";     // Written by a counselling round
+const string CDC_FILE = "students.cdc"; // Change events for downstream consumers (see ChangeStream)
+const string CDC_PENDING_FILE = "students.cdc.pending"; // Events of a snapshot being written, see compactStudentStore
+const string JOURNAL_FILE = "students.journal"; // Changes made since the snapshot was last written
+const size_t JOURNAL_COMPACT_THRESHOLD = 1000; // Journal entries before folding them into the snapshot
+// Group commit: queued journal lines are written and fsynced every
+// COMMIT_INTERVAL_MS, or sooner once COMMIT_BATCH_ENTRIES are waiting.
+// The environment variables UGC_COMMIT_INTERVAL_MS and UGC_COMMIT_BATCH_ENTRIES override them.
+const int COMMIT_INTERVAL_MS = 200;
+const size_t COMMIT_BATCH_ENTRIES = 256;
 const double MANAGEMENT_DISCOUNT_PERCENTAGE = 10.0; // 10% discount for management admissions
+const double MAX_FEES_PAID = 1e9; // INR; larger is a corrupt row, and keeps fee totals in paise within int64_t
+const size_t MIN_PARSE_CHUNK_BYTES = 1 << 20; // Smaller files are not worth splitting across threads
+const size_t MIN_GENERATE_ROWS_PER_THREAD = 10000;
+const size_t MIN_AUDIT_ROWS_PER_THREAD = 65536;
+const int64_t UNPRICED_FEES = INT64_MIN; // Fee audit: course not in courses.txt, or not a KCET/Management admission
+const uint32_t FIRST_STUDENT_NUMBER = 1001;
+const size_t TOMBSTONE_COMPACT_PERCENT = 25; // Dead share of the slots that triggers compactStudentSlots()
+SnapshotFormat snapshotFormat = SnapshotFormat::Csv; // Format compaction writes back
+uint32_t nextStudentNumber = FIRST_STUDENT_NUMBER; // High-water mark behind generateStudentID()
+vector<StudentShard> studentShards; // Sharded format: the manifest, one entry per course
+vector<uint8_t> changedShardCourses; // Sharded format: courseId -> changed since its shard was written
+// Compaction rewrites the two above while holding storeMutex only shared (on
+// the writer thread), and storedStudentCount() reads them without storeMutex,
+// so every change to them and every unlocked read takes this
+mutex shardMetadataMutex;
+atomic<size_t> unloadedShardCount{0}; // Shards not yet read into students
+// Sharded format: the journal could not be replayed because a shard could not
+// be read. The store then stays incomplete, refusing changes and saves, until
+// a restart replays it.
+bool journalHeldBack = false;
+ofstream journalOut;
+size_t journalEntryCount = 0; // Written by the journal writer thread once it is running
+JournalWriter journalWriter;
+ChangeStream changeStream;
 
 // --- Function Prototypes ---
+int runCommandLineTool(int argc, char* argv[]);
 void loadStudentsFromFile();
-void saveStudentsToFile();
+bool saveStudentsToFile();
+bool readStudentsCsv(const string& path, vector<Student>& out);
+bool writeStudentsCsv(const string& path, const vector<Student>& records);
+bool readStudentSnapshot(const string& path, vector<Student>& out);
+bool writeStudentSnapshot(const string& path, const vector<Student>& records);
+bool writeStudentSnapshotRows(const string& path, const vector<const Student*>& rows);
+bool readShardManifest(const string& directory, vector<StudentShard>& shards);
+bool writeShardManifest(const string& directory, const vector<StudentShard>& shards);
+bool readStudentShards(const string& directory, const vector<StudentShard>& shards, const vector<size_t>& which,
+                       vector<Student>& out, vector<uint8_t>* shardRead = nullptr);
+bool writeStudentShards(const string& directory, const vector<Student>& records, vector<StudentShard>& shards,
+                        const vector<uint8_t>* changedCourses);
+bool loadStudentShards(const vector<size_t>& which);
+bool ensureAllShardsLoaded();
+bool ensureCourseShardLoaded(string_view course);
+bool loadShardsForBatchCommand(string_view command, string_view args);
+void noteCourseChanged(uint16_t courseId);
+size_t storedStudentCount();
+void loadStudentStore();
+bool saveStudentStore(bool announce);
+void writeStudentLine(ostream& out, const Student& s);
+void replayStudentJournal();
+void journalStudentWrite(char op, const Student& s);
+void journalStudentDelete(const string& id);
+void journalCourseWithdrawal(const string& course, const vector<string>& withdrawnIds);
+bool compactStudentStore();
+bool foldJournalBeforeBulkChange();
+bool compactStudentStore(char op, const vector<uint32_t>& slots);
+bool isLoadedChange(const ChangeEvent& e);
+int runChangeTail(const string& checkpointPath, bool follow);
+void shutdownStudentStore();
+bool replaceFileDurably(const string& tempFile, const string& path);
+bool executeLockedBatchCommand(string_view command, string_view args, ostream& out);
 void loadCoursesFromFile();
 void saveCoursesToFile();
-string generateStudentID();
+bool generateStudentID(string& id);
+void noteStudentID(string_view id);
+void loadStudentIDCounter();
+bool saveStudentIDCounter();
+void loadCourseCatalog();
 void addStudent();
 void displayAllStudents();
 void searchStudentByID();
 void updateStudentDetails();
 void deleteStudentByID();
 void sortStudentsByRank();
-void generateSampleStudents(int count);
+bool generateSampleStudents(size_t count, ostream& out);
 void displayCourseDetails();
 void countAdmissionsByType();
 void clearInputBuffer();
 void promptForEnter();
+bool parseStudentFields(string_view* fields, int fieldCount, StudentRowView& row, RowError& error);
+const char* splitCsvRecord(const char* begin, const char* end, string_view fields[], int maxFields, int& fieldCount,
+                           size_t* quotedLineBreaks = nullptr);
+string_view unquoteCsvField(string_view raw, string& scratch);
+CsvQuoteState advanceCsvQuoteState(const char* p, const char* stop, const char* fileBegin, CsvQuoteState state);
+const char* nextCsvRecordStart(const char* p, const char* end, const char* fileBegin, CsvQuoteState state);
+void writeCsvField(ostream& out, string_view field);
+#ifdef HAVE_AVX2_KERNELS
+bool cpuHasAvx2();
+#endif
+Student materializeStudent(const StudentRowView& row, StringDictionary& courseDictionary, StringDictionary& typeDictionary);
+void adoptDictionaryIds(Student* first, Student* last, const StringDictionary& localCourses, const StringDictionary& localTypes);
+bool hasDictionaryIds(const Student& s, RowError& error);
+size_t dropStudentsWithoutIds(vector<Student>& records, size_t from);
+size_t dropStudentsWithBadNumbers(vector<Student>& records, size_t from, const string& path);
+const string& courseName(const Student& s);
+const string& admissionTypeName(const Student& s);
+void indexCourses();
+void parseStudentChunk(const char* begin, const char* end, StudentChunkResult& result);
+uint32_t findStudentSlot(string_view id);
+bool insertStudentRecord(Student s);
+void replaceStudentRecord(uint32_t slot, Student updated);
+bool removeStudentRecord(string_view id);
+size_t liveStudentCount();
+void compactStudentSlots();
+void compactStudentSlotsIfDue();
+size_t withdrawCourseStudents(uint16_t courseId, vector<string>* withdrawnIds = nullptr);
+void indexStudent(uint32_t slot);
+void unindexStudent(uint32_t slot);
+void rebuildStudentIndexes();
+void rebuildContactIndexes();
+bool checkUniqueContacts(const Student& s, uint32_t ownSlot, string& error);
+void readUniqueContact(string& value, const StudentKeyIndex& index, const char* what, uint32_t ownSlot);
+size_t reportDuplicateContacts(OutputBuffer& out, string Student::*field, StudentKeyIndex::KeyNormalizer normalize,
+                               const char* label);
+void displayDuplicateContacts();
 void initializeDefaultCourses(); // New function to add default courses
+const Course* findCourse(uint16_t courseId);
+double calculateFees(const Course& course, uint16_t admissionTypeId);
+void printStudentDetails(ostream& out, const Student& s);
+void renderStudentDetails(OutputBuffer& out, const Student& s);
+size_t renderStudentList(OutputBuffer& out, size_t& cursor, size_t count);
+bool exportStudentListing(const string& path);
+size_t visitStudentsByRank(int fromRank, int toRank, uint16_t courseId, size_t limit, RankPageCursor& cursor,
+                           const function<void(const Student&)>& visit);
+size_t visitStudentsByMarks(double minMarks, double maxMarks, uint16_t courseId, size_t limit,
+                            const function<void(const Student&)>& visit);
+void searchStudentsByRange();
+void searchStudentsByText();
+void withdrawCourse();
+void countAdmissions(size_t& kcetCount, size_t& managementCount);
+void renderAdmissionStatistics(OutputBuffer& out);
+const StudentColumns& studentColumns();
+ColumnStatistics computeColumnStatistics(const vector<double>& column);
+void renderColumnStatistics(OutputBuffer& out, const char* title, const ColumnStatistics& stats);
+void displayStudentStatistics();
+double averageMilliseconds(int repeats, const function<void()>& body);
+int runStatisticsBenchmark(size_t rows);
+bool parseQuery(string_view text, QueryPlan& plan, string& error);
+vector<uint32_t> executeQuery(const QueryPlan& plan, const StudentColumns& columns, size_t& matched);
+bool runQuery(string_view text, ostream& out);
+void queryStudents();
+int runQueryBenchmark(size_t rows);
+bool loadShardsForQuery(string_view text);
+void allocateSeats(const CounsellingInput& input, CounsellingResult& result);
+bool loadSeatMatrix(const string& path, vector<uint32_t>& seats);
+bool loadPreferences(const string& path, CounsellingInput& input);
+bool runCounselling(const string& seatsPath, const string& preferencesPath, const string& allotmentPath, ostream& out);
+void runSeatAllocation();
+int runCounsellingBenchmark(size_t candidates, size_t courseCount);
+vector<string_view> splitFields(string_view text, char delimiter);
+vector<FeeMismatch> auditStudentFees();
+void renderFeeAudit(OutputBuffer& out, const vector<FeeMismatch>& mismatches, size_t limit);
+size_t applyFeeCorrections(const vector<FeeMismatch>& mismatches);
+void auditFees();
+int runDirtyParseBenchmark(size_t rows, unsigned badPercent);
+int runBatchMode(istream& in);
+bool executeBatchCommand(string_view command, string_view args, ostream& out);
+bool isReadOnlyBatchCommand(string_view command);
+int runServer(const string& socketPath);
+int runLoadGenerator(const string& socketPath, size_t clientCount, double seconds, unsigned writePercent);
 
 // --- Main Function ---
-int main() {
-    loadCoursesFromFile(); // Load courses first
-    // If courses file was empty or not found, initialize some default courses
-    if (courses.empty()) {
-        cout << "No course data found. Initializing default courses.\n";
-        initializeDefaultCourses();
-        saveCoursesToFile(); // Save default courses
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        return runCommandLineTool(argc, argv); // Offline tools, no menu
     }
 
-    loadStudentsFromFile(); // Load students
+    loadCourseCatalog(); // Load courses first
+
+    loadStudentStore(); // Load students
+    replayStudentJournal(); // Re-apply changes made since the last full save
 
     // Generate sample students only if no student data is loaded
-    if (students.empty()) {
+    if (storedStudentCount() == 0) {
         cout << "No student data found. Generating 30 sample students.\n";
-        generateSampleStudents(30);
+        generateSampleStudents(30, cout);
     }
 
     int choice;
@@ -87,10 +921,18 @@ int main() {
         cout << "3. Search Student by ID\n";
         cout << "4. Update Student Details\n";
         cout << "5. Delete Student by ID\n";
-        cout << "6. Sort Students by Rank\n";
+        cout << "6. View Students by Rank\n";
         cout << "7. Display Course Details & Fees\n";
         cout << "8. Count Admissions by Type (KCET/Management)\n";
         cout << "9. Exit\n";
+        cout << "10. Marks, Package & Fees Statistics\n";
+        cout << "11. Search Students by Marks or Rank Range\n";
+        cout << "12. Search Students by Name or Email\n";
+        cout << "13. Withdraw All Students from a Course\n";
+        cout << "14. Query Students\n";
+        cout << "15. Run Counselling Round (Seat Allocation)\n";
+        cout << "16. Audit Fees Against Course Table\n";
+        cout << "17. Report Duplicate Phone Numbers & Emails\n";
         cout << "Enter your choice: ";
         cin >> choice;
         clearInputBuffer(); // Clear the buffer after reading an integer
@@ -122,10 +964,34 @@ int main() {
                 break;
             case 9:
                 cout << "Saving data and Exiting...\n";
-                saveStudentsToFile();
+                shutdownStudentStore();
+                break;
+            case 10:
+                displayStudentStatistics();
+                break;
+            case 11:
+                searchStudentsByRange();
+                break;
+            case 12:
+                searchStudentsByText();
+                break;
+            case 13:
+                withdrawCourse();
+                break;
+            case 14:
+                queryStudents();
+                break;
+            case 15:
+                runSeatAllocation();
+                break;
+            case 16:
+                auditFees();
+                break;
+            case 17:
+                displayDuplicateContacts();
                 break;
             default:
-                cout << "Invalid choice. Please enter a number between 1 and 9.\n";
+                cout << "Invalid choice. Please enter a number between 1 and 17.\n";
         }
         promptForEnter(); // Pause after each operation
     } while (choice != 9);
@@ -144,536 +1010,5557 @@ void promptForEnter() {
     cin.get(); // Wait for Enter key (consumes the newline from previous input)
 }
 
-// Function to save students data to file
-void saveStudentsToFile() {
-    ofstream outFile(STUDENTS_FILE);
-    if (!outFile.is_open()) {
-        cerr << "Error: Could not open students file for writing.\n";
-        return;
-    }
-    for (const auto& s : students) {
-        outFile << s.name << ","
-                << s.phoneNumber << ","
-                << s.email << ","
-                << s.address << ","
-                << s.bloodGroup << ","
-                << s.studentID << ","
-                << s.admittedCourse << ","
-                << s.admissionType << ","
-                << fixed << setprecision(2) << s.totalMarks << "," // Format double
-                << s.rankObtained << ","
-                << fixed << setprecision(2) << s.expectedPackage << "," // Format double
-                << fixed << setprecision(2) << s.feesPaid << "\n"; // Format double
+// --- Fast Loading Helpers ---
+
+#ifdef _WIN32
+bool MappedFile::open(const string& path) {
+    close();
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file_, &fileSize)) {
+        close();
+        return false;
     }
-    outFile.close();
-    cout << "Students data saved successfully.\n";
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+    if (size_ == 0) return true; // Empty files cannot be mapped, but they are valid
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr) {
+        close();
+        return false;
+    }
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        close();
+        return false;
+    }
+    return true;
 }
 
-// Function to load students data from file with error handling
-void loadStudentsFromFile() {
-    ifstream inFile(STUDENTS_FILE);
-    if (!inFile.is_open()) {
-        cerr << "Warning: Students file not found or could not be opened. Starting with empty data.\n";
-        return;
+void MappedFile::close() {
+    if (data_ != nullptr) UnmapViewOfFile(data_);
+    if (mapping_ != nullptr) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+    size_ = 0;
+}
+#else
+bool MappedFile::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        madvise(p, size_, MADV_SEQUENTIAL); // We read front to back exactly once
+        data_ = static_cast<const char*>(p);
     }
-    students.clear(); // Clear existing data
+    ::close(fd); // The mapping stays valid after the descriptor is closed
+    return true;
+}
 
-    string line;
-    int lineNumber = 0;
-    while (getline(inFile, line)) {
-        lineNumber++;
-        stringstream ss(line);
-        string segment;
-        Student s;
+void MappedFile::close() {
+    if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+#endif
 
-        try {
-            // Parsing string fields
-            if (!getline(ss, s.name, ',')) throw runtime_error("Name missing");
-            if (!getline(ss, s.phoneNumber, ',')) throw runtime_error("Phone number missing");
-            if (!getline(ss, s.email, ',')) throw runtime_error("Email missing");
-            if (!getline(ss, s.address, ',')) throw runtime_error("Address missing");
-            if (!getline(ss, s.bloodGroup, ',')) throw runtime_error("Blood group missing");
-            if (!getline(ss, s.studentID, ',')) throw runtime_error("Student ID missing");
-            if (!getline(ss, s.admittedCourse, ',')) throw runtime_error("Admitted course missing");
-            if (!getline(ss, s.admissionType, ',')) throw runtime_error("Admission type missing");
-
-            // Parsing numeric fields with conversion and error checking
-            if (!getline(ss, segment, ',')) throw runtime_error("Total marks missing");
-            s.totalMarks = stod(segment);
-
-            if (!getline(ss, segment, ',')) throw runtime_error("Rank obtained missing");
-            s.rankObtained = stoi(segment);
-
-            if (!getline(ss, segment, ',')) throw runtime_error("Expected package missing");
-            s.expectedPackage = stod(segment);
-
-            if (!getline(ss, segment)) throw runtime_error("Fees paid missing"); // Last segment
-            s.feesPaid = stod(segment);
-
-            students.push_back(s);
-        } catch (const invalid_argument& e) {
-            cerr << "Error parsing students.txt at line " << lineNumber << ": Invalid number format. " << e.what() << " on segment: \"" << segment << "\". Full line: \"" << line << "\"\n";
-        } catch (const out_of_range& e) {
-            cerr << "Error parsing students.txt at line " << lineNumber << ": Numeric value out of range. " << e.what() << " on segment: \"" << segment << "\". Full line: \"" << line << "\"\n";
-        } catch (const runtime_error& e) {
-            cerr << "Error parsing students.txt at line " << lineNumber << ": Data missing or malformed. " << e.what() << ". Full line: \"" << line << "\"\n";
-        } catch (const exception& e) {
-            cerr << "An unexpected error occurred while parsing students.txt at line " << lineNumber << ": " << e.what() << ". Full line: \"" << line << "\"\n";
-        }
-    }
-    inFile.close();
-    cout << "Students data loaded (or attempted to load) successfully.\n";
+bool LineReader::next(string_view& line) {
+    if (cursor_ >= end_) return false;
+    const char* nl = static_cast<const char*>(memchr(cursor_, '\n', end_ - cursor_));
+    line = string_view(cursor_, (nl ? nl : end_) - cursor_);
+    cursor_ = nl ? nl + 1 : end_;
+    lineNumber_++;
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return true;
 }
 
-// Function to save course data to file
-void saveCoursesToFile() {
-    ofstream outFile(COURSES_FILE);
-    if (!outFile.is_open()) {
-        cerr << "Error: Could not open courses file for writing.\n";
-        return;
-    }
-    for (const auto& c : courses) {
-        outFile << c.courseName << ","
-                << fixed << setprecision(2) << c.kcetFees << ","
-                << fixed << setprecision(2) << c.managementFees << "\n";
+// Parses a whole field as a number, allowing surrounding blanks and a leading
+// '+'. Never throws and never allocates, so bad input costs no more than good.
+template <typename T>
+FieldStatus parseNumber(string_view field, T& value) {
+    while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) field.remove_prefix(1);
+    while (!field.empty() && (field.back() == ' ' || field.back() == '\t')) field.remove_suffix(1);
+    if (!field.empty() && field.front() == '+') field.remove_prefix(1); // from_chars rejects a leading '+'
+    auto result = from_chars(field.data(), field.data() + field.size(), value);
+    if (result.ec == errc::result_out_of_range) return FieldStatus::OutOfRange;
+    if (result.ec != errc() || result.ptr != field.data() + field.size()) return FieldStatus::Invalid;
+    if constexpr (is_floating_point<T>::value) {
+        // from_chars also accepts "nan" and "inf"; no marks, package or fee is
+        // either, and NaN would break the ordered indexes and histogram bins
+        if (!isfinite(value)) return FieldStatus::Invalid;
     }
-    outFile.close();
-    cout << "Courses data saved successfully.\n";
+    return FieldStatus::Ok;
 }
 
-// Function to load course data from file with error handling
-void loadCoursesFromFile() {
-    ifstream inFile(COURSES_FILE);
-    if (!inFile.is_open()) {
-        cerr << "Warning: Courses file not found or could not be opened. Starting with empty course data.\n";
-        return;
+template <typename T>
+bool parseNumberField(string_view field, T& value, const char* fieldName, string& error) {
+    FieldStatus status = parseNumber(field, value);
+    if (status == FieldStatus::OutOfRange) {
+        error = string("Numeric value out of range. ") + fieldName;
+        return false;
     }
-    courses.clear(); // Clear existing data
+    if (status != FieldStatus::Ok) {
+        error = string("Invalid number format. ") + fieldName;
+        return false;
+    }
+    return true;
+}
 
-    string line;
-    int lineNumber = 0;
-    while (getline(inFile, line)) {
-        lineNumber++;
-        stringstream ss(line);
-        string segment;
-        Course c;
+// --- CSV Tokenizer ---
+// RFC 4180 records: fields are separated by commas and records by newlines. A
+// field may be wrapped in double quotes and then holds commas, newlines and
+// doubled quotes ("") as data. Only a quote at the start of a field opens a
+// quoted field; files written before fields were quoted can have a quote in
+// the middle of a field (12" Main Rd), which is kept as data. The AVX2 path
+// finds separators 32 bytes per step and hands each quoted field to
+// skipQuotedCsvField().
 
-        try {
-            if (!getline(ss, c.courseName, ',')) throw runtime_error("Course name missing");
-            
-            if (!getline(ss, segment, ',')) throw runtime_error("KCET fees missing");
-            c.kcetFees = stod(segment);
+// Returns the byte after the quote that closes the quoted field opening at q,
+// or end if it never closes
+const char* skipQuotedCsvField(const char* q, const char* end, size_t* quotedLineBreaks) {
+    for (const char* p = q + 1; p < end; ++p) {
+        if (*p == '"') {
+            if (p + 1 < end && p[1] == '"') ++p; // Doubled quote is data
+            else return p + 1;
+        } else if (*p == '\n' && quotedLineBreaks) {
+            ++*quotedLineBreaks;
+        }
+    }
+    return end;
+}
 
-            if (!getline(ss, segment)) throw runtime_error("Management fees missing"); // Last segment
-            c.managementFees = stod(segment);
+// Finishes a record one byte at a time from p, where the current field began
+// at fieldStart. Shared by the scalar and AVX2 paths.
+const char* finishCsvRecord(const char* p, const char* end, const char* fieldStart,
+                            string_view fields[], int maxFields, int& fieldCount, size_t* quotedLineBreaks) {
+    for (; p < end; ++p) {
+        char c = *p;
+        if (c == '"' && p == fieldStart) {
+            p = skipQuotedCsvField(p, end, quotedLineBreaks) - 1; // Resume after the closing quote
+        } else if (c == ',' || c == '\n') {
+            if (fieldCount < maxFields) fields[fieldCount] = string_view(fieldStart, p - fieldStart);
+            fieldCount++;
+            fieldStart = p + 1;
+            if (c == '\n') return p + 1;
+        }
+    }
+    if (fieldCount < maxFields) fields[fieldCount] = string_view(fieldStart, end - fieldStart);
+    fieldCount++;
+    return end;
+}
 
-            courses.push_back(c);
-        } catch (const invalid_argument& e) {
-            cerr << "Error parsing courses.txt at line " << lineNumber << ": Invalid number format. " << e.what() << " on segment: \"" << segment << "\". Full line: \"" << line << "\"\n";
-        } catch (const out_of_range& e) {
-            cerr << "Error parsing courses.txt at line " << lineNumber << ": Numeric value out of range. " << e.what() << " on segment: \"" << segment << "\". Full line: \"" << line << "\"\n";
-        } catch (const runtime_error& e) {
-            cerr << "Error parsing courses.txt at line " << lineNumber << ": Data missing or malformed. " << e.what() << ". Full line: \"" << line << "\"\n";
-        } catch (const exception& e) {
-            cerr << "An unexpected error occurred while parsing courses.txt at line " << lineNumber << ": " << e.what() << ". Full line: \"" << line << "\"\n";
+#ifdef HAVE_AVX2_KERNELS
+__attribute__((target("avx2"))) const char* splitCsvRecordAvx2(const char* p, const char* end, string_view fields[],
+                                                               int maxFields, int& fieldCount, size_t* quotedLineBreaks) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const char* fieldStart = p;
+    fieldCount = 0;
+    while (end - p >= 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        uint32_t quotes = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, quote)));
+        uint32_t separators = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, comma))) |
+                              static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+        // Quotes right after a separator (or at the current field start) open a
+        // quoted field. Separators before the first of those are real; the rest
+        // of the block is rescanned after the quoted field.
+        uint32_t opens = quotes & ((separators << 1) | (fieldStart == p ? 1u : 0u));
+        if (opens) separators &= (1u << __builtin_ctz(opens)) - 1;
+        while (separators) {
+            const char* at = p + __builtin_ctz(separators);
+            if (fieldCount < maxFields) fields[fieldCount] = string_view(fieldStart, at - fieldStart);
+            fieldCount++;
+            fieldStart = at + 1;
+            if (*at == '\n') return at + 1;
+            separators &= separators - 1;
         }
+        p = opens ? skipQuotedCsvField(p + __builtin_ctz(opens), end, quotedLineBreaks) : p + 32;
     }
-    inFile.close();
-    cout << "Courses data loaded (or attempted to load) successfully.\n";
+    return finishCsvRecord(p, end, fieldStart, fields, maxFields, fieldCount, quotedLineBreaks);
 }
+#endif
 
-// Function to add default engineering courses
-void initializeDefaultCourses() {
-    courses.push_back({"Computer Science Engineering", 150000.0, 250000.0});
-    courses.push_back({"Electronics & Communication Engineering", 120000.0, 200000.0});
-    courses.push_back({"Mechanical Engineering", 100000.0, 180000.0});
-    courses.push_back({"Civil Engineering", 90000.0, 160000.0});
-    cout << "Default courses initialized.\n";
+// Splits the record starting at begin into raw fields (quotes still on) and
+// returns where the next record starts. fieldCount is the real number of
+// fields, which may exceed maxFields; only the first maxFields are stored.
+// If quotedLineBreaks is given, the line breaks inside quoted fields are added
+// to it, so callers can keep physical line numbers for error messages.
+const char* splitCsvRecord(const char* begin, const char* end, string_view fields[], int maxFields, int& fieldCount,
+                           size_t* quotedLineBreaks) {
+#ifdef HAVE_AVX2_KERNELS
+    if (cpuHasAvx2()) return splitCsvRecordAvx2(begin, end, fields, maxFields, fieldCount, quotedLineBreaks);
+#endif
+    fieldCount = 0;
+    return finishCsvRecord(begin, end, begin, fields, maxFields, fieldCount, quotedLineBreaks);
+}
+
+// Strips the quotes from a quoted field, undoubling "" into scratch only when
+// the field has any. Unquoted fields come back unchanged.
+string_view unquoteCsvField(string_view raw, string& scratch) {
+    if (raw.size() < 2 || raw.front() != '"' || raw.back() != '"') return raw;
+    string_view inner = raw.substr(1, raw.size() - 2);
+    if (inner.find('"') == string_view::npos) return inner;
+    scratch.clear();
+    for (size_t i = 0; i < inner.size(); ++i) {
+        scratch += inner[i];
+        if (inner[i] == '"' && i + 1 < inner.size() && inner[i + 1] == '"') ++i;
+    }
+    return scratch;
 }
 
+// Writes a field, quoting it only if it holds a comma, quote or line break
+void writeCsvField(ostream& out, string_view field) {
+    if (field.find_first_of(",\"\r\n") == string_view::npos) {
+        out << field;
+        return;
+    }
+    out << '"';
+    for (char c : field) {
+        if (c == '"') out << '"';
+        out << c;
+    }
+    out << '"';
+}
 
-// Function to generate a unique student ID
-string generateStudentID() {
-    static int nextID = 1001; // Starting ID
-    // Find the maximum existing ID to ensure uniqueness across sessions
-    if (!students.empty()) {
-        int maxExistingID = 0;
-        for (const auto& s : students) {
-            // Only try to convert if the ID starts with "SID" and is long enough
-            if (s.studentID.length() > 3 && s.studentID.substr(0, 3) == "SID") {
-                try {
-                    int id = stoi(s.studentID.substr(3)); // Extract numeric part
-                    if (id > maxExistingID) {
-                        maxExistingID = id;
-                    }
-                } catch (const invalid_argument& e) {
-                    cerr << "Warning: Non-numeric student ID found: " << s.studentID << ". Skipping for max ID calculation.\n";
-                } catch (const out_of_range& e) {
-                    cerr << "Warning: Student ID out of range: " << s.studentID << ". Skipping for max ID calculation.\n";
-                }
-            }
+// Whether a quote at p, outside any quoted field, opens one
+inline bool opensCsvQuote(const char* p, const char* fileBegin) {
+    return p == fileBegin || p[-1] == ',' || p[-1] == '\n';
+}
+
+// Runs the tokenizer's quote rules over [p, stop) starting in `state`, without
+// splitting fields. Only quotes change the state, so it jumps between them
+// with memchr. Used to find the quote state at chunk split points.
+CsvQuoteState advanceCsvQuoteState(const char* p, const char* stop, const char* fileBegin, CsvQuoteState state) {
+    while (p < stop) {
+        if (state == CsvQuoteState::JustClosed) { // A quote right after the closing one is a doubled quote
+            state = *p++ == '"' ? CsvQuoteState::Inside : CsvQuoteState::Outside;
+            continue;
         }
-        if (maxExistingID >= nextID) {
-            nextID = maxExistingID + 1;
+        const char* q = static_cast<const char*>(memchr(p, '"', stop - p));
+        if (!q) break;
+        if (state == CsvQuoteState::Inside) state = CsvQuoteState::JustClosed;
+        else if (opensCsvQuote(q, fileBegin)) state = CsvQuoteState::Inside;
+        p = q + 1;
+    }
+    return state;
+}
+
+// Where the first record starting after p begins, given the quote state at p.
+// Used to split a file into chunks on record boundaries.
+const char* nextCsvRecordStart(const char* p, const char* end, const char* fileBegin, CsvQuoteState state) {
+    for (; p < end; ++p) {
+        if (state == CsvQuoteState::Inside) {
+            if (*p == '"') state = CsvQuoteState::JustClosed;
+        } else if (state == CsvQuoteState::JustClosed && *p == '"') {
+            state = CsvQuoteState::Inside;
+        } else {
+            state = CsvQuoteState::Outside;
+            if (*p == '"' && opensCsvQuote(p, fileBegin)) state = CsvQuoteState::Inside;
+            else if (*p == '\n') return p + 1;
         }
     }
-    return "SID" + to_string(nextID++);
+    return end;
 }
 
-// Function to add a new student
-void addStudent() {
-    Student s;
-    cout << "\n--- Add New Student ---\n";
+// --- Parse Error Report ---
 
-    s.studentID = generateStudentID(); // Assign unique ID
+ParseErrorReport::Group& ParseErrorReport::group(const RowError& error) {
+    for (auto& g : groups_) {
+        if (g.error.field == error.field && g.error.status == error.status) return g;
+    }
+    groups_.emplace_back();
+    groups_.back().error = error;
+    return groups_.back();
+}
 
-    cout << "Enter student name: ";
-    getline(cin, s.name);
-    cout << "Enter phone number: ";
-    getline(cin, s.phoneNumber);
-    cout << "Enter email: ";
-    getline(cin, s.email);
-    cout << "Enter address: ";
-    getline(cin, s.address);
-    cout << "Enter blood group: ";
-    getline(cin, s.bloodGroup);
+void ParseErrorReport::add(const RowError& error, size_t line, string_view text) {
+    Group& g = group(error);
+    if (g.count++ == 0) g.sample.assign(text);
+    if (g.lines.size() < SAMPLE_LINES) g.lines.push_back(line);
+    total_++;
+}
 
-    // Course selection
-    if (courses.empty()) {
-        cout << "No courses available. Please add courses by modifying 'courses.txt' or ensure it's not empty.\n";
-        return;
-    }
-    displayCourseDetails();
-    cout << "Enter the exact course name for admission: ";
-    getline(cin, s.admittedCourse);
-    bool courseFound = false;
-    Course selectedCourse;
-    for (const auto& c : courses) {
-        if (c.courseName == s.admittedCourse) {
-            selectedCourse = c;
-            courseFound = true;
-            break;
+// Appends another report whose line numbers start lineOffset lines later
+void ParseErrorReport::merge(const ParseErrorReport& other, size_t lineOffset) {
+    for (const auto& theirs : other.groups_) {
+        Group& g = group(theirs.error);
+        if (g.count == 0) g.sample = theirs.sample;
+        g.count += theirs.count;
+        for (size_t line : theirs.lines) {
+            if (g.lines.size() < SAMPLE_LINES) g.lines.push_back(lineOffset + line);
         }
     }
-    if (!courseFound) {
-        cout << "Error: Course not found. Please enter an exact course name from the list.\n";
-        return;
-    }
+    total_ += other.total_;
+}
 
-    cout << "Enter admission type (KCET/Management): ";
-    getline(cin, s.admissionType);
-    while (s.admissionType != "KCET" && s.admissionType != "Management") {
-        cout << "Invalid admission type. Please enter 'KCET' or 'Management': ";
-        getline(cin, s.admissionType);
+void ParseErrorReport::print(ostream& out, const string& path, const char* const fieldNames[]) const {
+    if (total_ == 0) return;
+    out << "Error: Skipped " << total_ << " bad line" << (total_ == 1 ? "" : "s") << " in " << path << ":\n";
+    for (const auto& g : groups_) {
+        const char* what = g.error.status == FieldStatus::Missing ? "missing"
+                         : g.error.status == FieldStatus::OutOfRange ? "number out of range"
+                         : g.error.status == FieldStatus::TooMany ? "followed by too many fields"
+                         : g.error.status == FieldStatus::Unknown ? "not found"
+                         : g.error.status == FieldStatus::Repeated ? "repeated"
+                         : g.error.status == FieldStatus::TooManyValues ? "has too many distinct values"
+                         : "invalid number";
+        out << "  " << g.count << " x " << fieldNames[g.error.field] << " " << what << ", line";
+        out << (g.count == 1 ? " " : "s ");
+        for (size_t i = 0; i < g.lines.size(); ++i) out << (i ? ", " : "") << g.lines[i];
+        if (g.count > g.lines.size()) out << ", ...";
+        out << "; first: \"" << g.sample << "\"\n";
     }
+}
 
-    if (s.admissionType == "KCET") {
-        s.feesPaid = selectedCourse.kcetFees;
-    } else { // Management
-        s.feesPaid = selectedCourse.managementFees * (1 - MANAGEMENT_DISCOUNT_PERCENTAGE / 100.0);
+// Unquotes the twelve student fields and parses the numeric ones. On failure
+// `error` names the field and what was wrong with it. Rows written before
+// fields were quoted can have commas inside the address; when there are
+// extra fields the surplus is joined back into the address.
+bool parseStudentFields(string_view* fields, int fieldCount, StudentRowView& row, RowError& error) {
+    if (fieldCount < STUDENT_FIELD_COUNT) {
+        error = {fieldCount, FieldStatus::Missing};
+        return false;
     }
-    cout << "Calculated Fees: " << fixed << setprecision(2) << s.feesPaid << " INR\n";
-
-    cout << "Enter total marks obtained (out of 500): ";
+    if (fieldCount > MAX_CSV_FIELDS) {
+        error = {STUDENT_FIELD_COUNT - 1, FieldStatus::TooMany};
+        return false;
+    }
+    int extra = fieldCount - STUDENT_FIELD_COUNT;
+    for (int i = 0; i < STUDENT_FIELD_COUNT; ++i) {
+        string_view raw = fields[i < 3 ? i : i + extra];
+        if (i == 3 && extra > 0) { // Legacy unquoted address: span the fields it was split into
+            const string_view& last = fields[3 + extra];
+            raw = string_view(fields[3].data(), last.data() + last.size() - fields[3].data());
+        }
+        row.fields[i] = unquoteCsvField(raw, row.unquoted[i]);
+    }
+
+    FieldStatus status;
+    if ((status = parseNumber(row.fields[8], row.totalMarks)) != FieldStatus::Ok) error = {8, status};
+    else if ((status = parseNumber(row.fields[9], row.rankObtained)) != FieldStatus::Ok) error = {9, status};
+    else if ((status = parseNumber(row.fields[10], row.expectedPackage)) != FieldStatus::Ok) error = {10, status};
+    else if ((status = parseNumber(row.fields[11], row.feesPaid)) != FieldStatus::Ok) error = {11, status};
+    else if (fabs(row.feesPaid) > MAX_FEES_PAID) error = {11, status = FieldStatus::OutOfRange};
+    return status == FieldStatus::Ok;
+}
+
+// Parses every record in [begin, end) into result. Runs on a loader worker
+// thread, so it must not touch the global students vector or write to the console.
+void parseStudentChunk(const char* begin, const char* end, StudentChunkResult& result) {
+    size_t lineCount = 0;
+    for (const char* p = begin; p < end; ++lineCount) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        p = nl ? nl + 1 : end;
+    }
+    result.students.reserve(lineCount);
+
+    StudentRowView row;
+    RowError error;
+    string_view fields[MAX_CSV_FIELDS];
+    int fieldCount;
+    const char* cursor = begin;
+    while (cursor < end) {
+        const char* recordStart = cursor;
+        size_t quotedLineBreaks = 0;
+        cursor = splitCsvRecord(cursor, end, fields, MAX_CSV_FIELDS, fieldCount, &quotedLineBreaks);
+        size_t recordLine = result.lineCount + 1; // Errors point at the line the record starts on
+        result.lineCount += 1 + quotedLineBreaks;
+
+        string_view line(recordStart, cursor - recordStart);
+        if (!line.empty() && line.back() == '\n') line.remove_suffix(1);
+        if (!line.empty() && line.back() == '\r') { // Tolerate CRLF files
+            line.remove_suffix(1);
+            if (fieldCount <= MAX_CSV_FIELDS) fields[fieldCount - 1].remove_suffix(1);
+        }
+        if (line.empty()) {
+            error = {0, FieldStatus::Missing};
+            result.errors.add(error, recordLine, line);
+        } else if (parseStudentFields(fields, fieldCount, row, error)) {
+            result.students.push_back(materializeStudent(row, result.courseNames, result.admissionTypes));
+            if (!hasDictionaryIds(result.students.back(), error)) {
+                result.students.pop_back();
+                result.errors.add(error, recordLine, line);
+            }
+        } else {
+            result.errors.add(error, recordLine, line);
+        }
+    }
+}
+
+// Copies a parsed row out of the mapping into an owning Student record. Course
+// and admission type are interned into the given dictionaries, which worker
+// threads keep private until adoptDictionaryIds() maps them to the globals.
+// A full dictionary leaves the ID as NOT_FOUND; see hasDictionaryIds().
+Student materializeStudent(const StudentRowView& row, StringDictionary& courseDictionary, StringDictionary& typeDictionary) {
+    Student s;
+    s.name.assign(row.fields[0]);
+    s.phoneNumber.assign(row.fields[1]);
+    s.email.assign(row.fields[2]);
+    s.address.assign(row.fields[3]);
+    s.bloodGroup.assign(row.fields[4]);
+    s.studentID.assign(row.fields[5]);
+    s.courseId = courseDictionary.intern(row.fields[6]);
+    s.admissionTypeId = typeDictionary.intern(row.fields[7]);
+    s.totalMarks = row.totalMarks;
+    s.rankObtained = row.rankObtained;
+    s.expectedPackage = row.expectedPackage;
+    s.feesPaid = row.feesPaid;
+    return s;
+}
+
+// Rewrites course and admission type IDs from thread-local dictionaries to the
+// global ones. Only touches the globals once per distinct value. Values the
+// global dictionaries have no room for become NOT_FOUND, as do IDs that were
+// already NOT_FOUND; dropStudentsWithoutIds() removes those records.
+void adoptDictionaryIds(Student* first, Student* last, const StringDictionary& localCourses, const StringDictionary& localTypes) {
+    vector<uint16_t> courseMap(localCourses.size()), typeMap(localTypes.size());
+    for (uint16_t id = 0; id < courseMap.size(); ++id) courseMap[id] = courseNames.intern(localCourses.name(id));
+    for (uint16_t id = 0; id < typeMap.size(); ++id) typeMap[id] = admissionTypes.intern(localTypes.name(id));
+    for (Student* s = first; s != last; ++s) {
+        if (s->courseId != StringDictionary::NOT_FOUND) s->courseId = courseMap[s->courseId];
+        if (s->admissionTypeId != StringDictionary::NOT_FOUND) s->admissionTypeId = typeMap[s->admissionTypeId];
+    }
+}
+
+// Whether interning gave the record both its IDs. If not, `error` names the
+// field whose dictionary was full.
+bool hasDictionaryIds(const Student& s, RowError& error) {
+    if (s.courseId == StringDictionary::NOT_FOUND) error = {6, FieldStatus::TooManyValues};
+    else if (s.admissionTypeId == StringDictionary::NOT_FOUND) error = {7, FieldStatus::TooManyValues};
+    else return true;
+    return false;
+}
+
+// Removes the records from `from` on that have no course or admission type ID
+// (see adoptDictionaryIds) and returns how many there were
+size_t dropStudentsWithoutIds(vector<Student>& records, size_t from) {
+    RowError error;
+    auto kept = remove_if(records.begin() + from, records.end(), [&error](const Student& s) { return !hasDictionaryIds(s, error); });
+    size_t dropped = records.end() - kept;
+    records.erase(kept, records.end());
+    return dropped;
+}
+
+// Removes the records from `from` on with a number parseStudentFields() would
+// reject (NaN, infinite, fees past MAX_FEES_PAID) and reports them against
+// path, numbering rows from 1. Binary snapshots store numbers unparsed, so a
+// damaged file could otherwise break the marks and rank index orderings.
+size_t dropStudentsWithBadNumbers(vector<Student>& records, size_t from, const string& path) {
+    ParseErrorReport errors;
+    RowError error;
+    size_t row = 0;
+    auto kept = remove_if(records.begin() + from, records.end(), [&](const Student& s) {
+        row++;
+        if (!isfinite(s.totalMarks)) error = {8, FieldStatus::Invalid};
+        else if (!isfinite(s.expectedPackage)) error = {10, FieldStatus::Invalid};
+        else if (!isfinite(s.feesPaid)) error = {11, FieldStatus::Invalid};
+        else if (fabs(s.feesPaid) > MAX_FEES_PAID) error = {11, FieldStatus::OutOfRange};
+        else return false;
+        errors.add(error, row, s.studentID);
+        return true;
+    });
+    size_t dropped = records.end() - kept;
+    records.erase(kept, records.end());
+    errors.print(cerr, path, STUDENT_FIELD_NAMES);
+    return dropped;
+}
+
+const string& courseName(const Student& s) {
+    return courseNames.name(s.courseId);
+}
+
+const string& admissionTypeName(const Student& s) {
+    return admissionTypes.name(s.admissionTypeId);
+}
+
+// --- Student Index ---
+
+// Phone numbers compare by their digits alone, so "98450 12345" and
+// "9845012345" are the same contact
+string_view normalizePhoneKey(string_view key, string& scratch) {
+    if (all_of(key.begin(), key.end(), [](char c) { return c >= '0' && c <= '9'; })) return key;
+    scratch.clear();
+    for (char c : key) {
+        if (c >= '0' && c <= '9') scratch += c;
+    }
+    return scratch;
+}
+
+// Emails compare case-insensitively (ASCII), as mail providers treat them
+string_view normalizeEmailKey(string_view key, string& scratch) {
+    if (none_of(key.begin(), key.end(), [](char c) { return c >= 'A' && c <= 'Z'; })) return key;
+    scratch.assign(key);
+    for (char& c : scratch) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return scratch;
+}
+
+size_t StudentKeyIndex::probe(string_view key, uint32_t hash) const {
+    size_t mask = buckets_.size() - 1;
+    string scratch;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Bucket& b = buckets_[i];
+        if (b.slot == NOT_FOUND || (b.hash == hash && recordKey(b.slot, scratch) == key)) return i;
+    }
+}
+
+uint32_t StudentKeyIndex::find(string_view rawKey) const {
+    string scratch;
+    string_view key = normalKey(rawKey, scratch);
+    if (buckets_.empty() || key.empty()) return NOT_FOUND;
+    return buckets_[probe(key, hashKey(key))].slot;
+}
+
+bool StudentKeyIndex::insert(uint32_t slot) {
+    string scratch;
+    string_view key = recordKey(slot, scratch);
+    if (key.empty()) return true;
+    if ((used_ + 1) * 4 > buckets_.size() * 3) grow(); // Keep load factor under 75%
+    uint32_t hash = hashKey(key);
+    Bucket& b = buckets_[probe(key, hash)];
+    if (b.slot != NOT_FOUND) {
+        if (b.slot != slot) duplicates_.emplace(hash, slot);
+        return false;
+    }
+    b.slot = slot;
+    b.hash = hash;
+    used_++;
+    return true;
+}
+
+void StudentKeyIndex::erase(uint32_t slot) {
+    string scratch, otherScratch;
+    string_view key = recordKey(slot, scratch);
+    if (buckets_.empty() || key.empty()) return;
+    size_t mask = buckets_.size() - 1;
+    uint32_t hash = hashKey(key);
+    size_t hole = probe(key, hash);
+    auto [first, last] = duplicates_.equal_range(hash);
+    if (buckets_[hole].slot != slot) { // Not indexed, or a duplicate of the indexed record
+        for (auto it = first; it != last; ++it) {
+            if (it->second == slot) {
+                duplicates_.erase(it);
+                break;
+            }
+        }
+        return;
+    }
+    // A live duplicate takes the key over, so it stays findable and unique checks still see it
+    for (auto it = first; it != last; ++it) {
+        if (recordKey(it->second, otherScratch) == key) {
+            buckets_[hole].slot = it->second;
+            duplicates_.erase(it);
+            return;
+        }
+    }
+    // Pull later entries of the probe run back into the hole so lookups never need tombstones
+    for (size_t i = (hole + 1) & mask; buckets_[i].slot != NOT_FOUND; i = (i + 1) & mask) {
+        size_t home = buckets_[i].hash & mask;
+        bool movable = (i > hole) ? (home <= hole || home > i) : (home <= hole && home > i);
+        if (movable) {
+            buckets_[hole] = buckets_[i];
+            hole = i;
+        }
+    }
+    buckets_[hole] = Bucket();
+    used_--;
+}
+
+void StudentKeyIndex::grow() {
+    vector<Bucket> old;
+    old.swap(buckets_);
+    buckets_.assign(old.empty() ? 64 : old.size() * 2, Bucket());
+    size_t mask = buckets_.size() - 1;
+    for (const Bucket& b : old) {
+        if (b.slot == NOT_FOUND) continue;
+        size_t i = b.hash & mask;
+        while (buckets_[i].slot != NOT_FOUND) i = (i + 1) & mask;
+        buckets_[i] = b;
+    }
+}
+
+void StudentKeyIndex::rebuild(const function<void(uint32_t)>& onDuplicate) {
+    size_t capacity = 64;
+    while (capacity * 3 < records_.size() * 4) capacity *= 2;
+    buckets_.assign(capacity, Bucket());
+    used_ = 0;
+    duplicates_.clear();
+    for (uint32_t slot = 0; slot < records_.size(); ++slot) {
+        if (records_[slot].deleted) continue;
+        if (!insert(slot)) onDuplicate(slot);
+    }
+}
+
+void warnDuplicateStudentID(uint32_t slot) {
+    cerr << "Warning: Duplicate student ID " << students[slot].studentID << " found. Only the first record with this ID can be looked up.\n";
+}
+
+// Re-indexes phone numbers and emails, reporting shared ones as one line
+void rebuildContactIndexes() {
+    size_t sharedPhones = 0, sharedEmails = 0;
+    phoneIndex.rebuild([&sharedPhones](uint32_t) { sharedPhones++; });
+    emailIndex.rebuild([&sharedEmails](uint32_t) { sharedEmails++; });
+    if (sharedPhones + sharedEmails > 0) {
+        cerr << "Warning: " << sharedPhones << " student(s) share a phone number and " << sharedEmails
+             << " an email with an earlier student. Run the duplicate contact report for the full list.\n";
+    }
+}
+
+// Rejects a phone number or email already held by a student other than
+// ownSlot (StudentKeyIndex::NOT_FOUND for a new student)
+bool checkUniqueContacts(const Student& s, uint32_t ownSlot, string& error) {
+    uint32_t owner = phoneIndex.find(s.phoneNumber);
+    if (owner != StudentKeyIndex::NOT_FOUND && owner != ownSlot) {
+        error = "phone number " + s.phoneNumber + " already belongs to " + students[owner].studentID;
+        return false;
+    }
+    owner = emailIndex.find(s.email);
+    if (owner != StudentKeyIndex::NOT_FOUND && owner != ownSlot) {
+        error = "email " + s.email + " already belongs to " + students[owner].studentID;
+        return false;
+    }
+    return true;
+}
+
+// Reads a phone number or email, asking again while another student holds it
+void readUniqueContact(string& value, const StudentKeyIndex& index, const char* what, uint32_t ownSlot) {
+    getline(cin, value);
+    uint32_t owner;
+    while ((owner = index.find(value)) != StudentKeyIndex::NOT_FOUND && owner != ownSlot) {
+        cout << "That " << what << " is already registered to " << students[owner].studentID
+             << ". Please enter another: ";
+        getline(cin, value);
+    }
+}
+
+// Every secondary structure keyed on a student slot is maintained through
+// these two hooks, so adding a new index only means touching them.
+void indexStudent(uint32_t slot) {
+    storeVersion++;
+    noteCourseChanged(students[slot].courseId);
+    studentIndex.insert(slot);
+    phoneIndex.insert(slot);
+    emailIndex.insert(slot);
+    rankIndex.insert(slot);
+    marksIndex.insert(slot);
+    textIndex.insert(slot);
+    admissionAggregates.add(students[slot]);
+    noteStudentID(students[slot].studentID);
+}
+
+void unindexStudent(uint32_t slot) {
+    storeVersion++;
+    noteCourseChanged(students[slot].courseId);
+    studentIndex.erase(slot);
+    phoneIndex.erase(slot);
+    emailIndex.erase(slot);
+    rankIndex.erase(slot); // Must run before the record changes, the key is read from it
+    marksIndex.erase(slot);
+    textIndex.erase(slot);
+    admissionAggregates.remove(students[slot]);
+}
+
+void rebuildStudentIndexes() {
+    storeVersion++;
+    studentIndex.rebuild(warnDuplicateStudentID);
+    rebuildContactIndexes();
+    textIndex.clear();
+    admissionAggregates.clear();
+    vector<uint32_t> live;
+    live.reserve(students.size());
+    for (uint32_t slot = 0; slot < students.size(); ++slot) {
+        if (students[slot].deleted) continue;
+        live.push_back(slot);
+        textIndex.insert(slot);
+        admissionAggregates.add(students[slot]);
+        noteStudentID(students[slot].studentID);
+    }
+    // Sorted input goes in at the end hint without a tree walk per slot
+    sort(live.begin(), live.end(), RankOrder());
+    rankIndex = set<uint32_t, RankOrder>(live.begin(), live.end());
+    sort(live.begin(), live.end(), MarksOrder());
+    marksIndex = set<uint32_t, MarksOrder>(live.begin(), live.end());
+}
+
+// --- Admission Aggregates ---
+
+void AdmissionAggregates::clear() {
+    byType_.clear();
+    byCourse_.clear();
+    byCourseType_.clear();
+    bloodGroups_.clear();
+}
+
+void AdmissionAggregates::bump(vector<AggregateCell>& cells, size_t index, int direction, int64_t feesPaise) {
+    if (index >= cells.size()) cells.resize(index + 1);
+    cells[index].count += direction;
+    cells[index].feesPaise += direction * feesPaise;
+}
+
+void AdmissionAggregates::apply(const Student& s, int direction) {
+    int64_t feesPaise = llround(s.feesPaid * 100.0);
+    bump(byType_, s.admissionTypeId, direction, feesPaise);
+    bump(byCourse_, s.courseId, direction, feesPaise);
+    if (s.courseId >= byCourseType_.size()) byCourseType_.resize(s.courseId + 1);
+    bump(byCourseType_[s.courseId], s.admissionTypeId, direction, feesPaise);
+    auto it = bloodGroups_.find(s.bloodGroup);
+    if (it == bloodGroups_.end()) it = bloodGroups_.emplace(s.bloodGroup, 0).first;
+    it->second += direction;
+    if (it->second == 0) bloodGroups_.erase(it);
+}
+
+// --- Rank Index ---
+
+bool RankOrder::operator()(uint32_t a, uint32_t b) const {
+    const Student& x = students[a];
+    const Student& y = students[b];
+    if (x.rankObtained != y.rankObtained) return x.rankObtained < y.rankObtained;
+    if (x.studentID != y.studentID) return x.studentID < y.studentID;
+    return a < b; // Only reachable with duplicate IDs from a damaged file
+}
+
+bool RankOrder::operator()(uint32_t a, const RankKey& b) const {
+    const Student& x = students[a];
+    if (x.rankObtained != b.rankObtained) return x.rankObtained < b.rankObtained;
+    return string_view(x.studentID) < b.studentID;
+}
+
+bool RankOrder::operator()(const RankKey& a, uint32_t b) const {
+    const Student& y = students[b];
+    if (a.rankObtained != y.rankObtained) return a.rankObtained < y.rankObtained;
+    return a.studentID < string_view(y.studentID);
+}
+
+// Visits up to `limit` students with rank in [fromRank, toRank], in rank order,
+// optionally only those in one course. The first call starts at fromRank;
+// later calls with the same cursor continue after the last student visited.
+// Only entries inside the rank range are touched.
+size_t visitStudentsByRank(int fromRank, int toRank, uint16_t courseId, size_t limit, RankPageCursor& cursor,
+                           const function<void(const Student&)>& visit) {
+    auto it = cursor.started ? rankIndex.upper_bound(RankKey{cursor.rankObtained, cursor.studentID})
+                             : rankIndex.lower_bound(RankKey{fromRank, string_view()});
+    size_t visited = 0;
+    for (; it != rankIndex.end() && visited < limit; ++it) {
+        const Student& s = students[*it];
+        if (s.rankObtained > toRank) break;
+        if (s.deleted || (courseId != ANY_COURSE && s.courseId != courseId)) continue;
+        visit(s);
+        visited++;
+        cursor.started = true;
+        cursor.rankObtained = s.rankObtained;
+        cursor.studentID = s.studentID;
+    }
+    return visited;
+}
+
+// --- Marks Index ---
+
+bool MarksOrder::operator()(uint32_t a, uint32_t b) const {
+    const Student& x = students[a];
+    const Student& y = students[b];
+    if (x.totalMarks != y.totalMarks) return x.totalMarks < y.totalMarks;
+    if (x.studentID != y.studentID) return x.studentID < y.studentID;
+    return a < b;
+}
+
+bool MarksOrder::operator()(uint32_t a, const MarksKey& b) const {
+    const Student& x = students[a];
+    if (x.totalMarks != b.totalMarks) return x.totalMarks < b.totalMarks;
+    return string_view(x.studentID) < b.studentID;
+}
+
+bool MarksOrder::operator()(const MarksKey& a, uint32_t b) const {
+    const Student& y = students[b];
+    if (a.totalMarks != y.totalMarks) return a.totalMarks < y.totalMarks;
+    return a.studentID < string_view(y.studentID);
+}
+
+// Visits up to `limit` students with total marks in [minMarks, maxMarks], in
+// ascending order of marks, optionally only those in one course
+size_t visitStudentsByMarks(double minMarks, double maxMarks, uint16_t courseId, size_t limit,
+                            const function<void(const Student&)>& visit) {
+    size_t visited = 0;
+    for (auto it = marksIndex.lower_bound(MarksKey{minMarks, string_view()}); it != marksIndex.end() && visited < limit; ++it) {
+        const Student& s = students[*it];
+        if (s.totalMarks > maxMarks) break;
+        if (s.deleted || (courseId != ANY_COURSE && s.courseId != courseId)) continue;
+        visit(s);
+        visited++;
+    }
+    return visited;
+}
+
+// --- Name and Email Search ---
+
+// ASCII-only lowercasing; cheaper than tolower() on the indexing path
+inline unsigned char lowerAscii(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return u >= 'A' && u <= 'Z' ? static_cast<unsigned char>(u + ('a' - 'A')) : u;
+}
+
+bool startsWithIgnoringCase(string_view text, string_view lowerPrefix) {
+    if (text.size() < lowerPrefix.size()) return false;
+    for (size_t i = 0; i < lowerPrefix.size(); ++i) {
+        if (lowerAscii(text[i]) != static_cast<unsigned char>(lowerPrefix[i])) return false;
+    }
+    return true;
+}
+
+bool containsIgnoringCase(string_view text, string_view lowerNeedle) {
+    return search(text.begin(), text.end(), lowerNeedle.begin(), lowerNeedle.end(), [](char a, char b) {
+        return lowerAscii(a) == static_cast<unsigned char>(b);
+    }) != text.end();
+}
+
+string toLowerCopy(string_view text) {
+    string lower(text);
+    for (char& c : lower) c = static_cast<char>(lowerAscii(c));
+    return lower;
+}
+
+// Lowercase characters [p, p + length), length <= 3, packed into the low 24
+// bits. Substring trigrams use tag 0; name prefixes are tagged with their
+// length so "ali" as a prefix and "ali" anywhere are different grams.
+uint32_t packGram(const char* p, size_t length, uint32_t tag) {
+    uint32_t gram = 0;
+    for (size_t i = 0; i < length; ++i) gram = gram << 8 | lowerAscii(p[i]);
+    return tag << 24 | gram;
+}
+
+void TextSearchIndex::collectGrams(const Student& s, vector<uint32_t>& out) {
+    out.clear();
+    for (size_t length = 1; length <= min<size_t>(3, s.name.size()); ++length) {
+        out.push_back(packGram(s.name.data(), length, static_cast<uint32_t>(length)));
+    }
+    for (const string* field : {&s.name, &s.email}) {
+        for (size_t i = 0; i + 3 <= field->size(); ++i) out.push_back(packGram(field->data() + i, 3, 0));
+    }
+    sort(out.begin(), out.end());
+    out.erase(unique(out.begin(), out.end()), out.end());
+}
+
+void TextSearchIndex::addPostings(uint32_t slot) {
+    collectGrams(records_[slot], scratch_);
+    for (uint32_t gram : scratch_) postings_[gram].push_back(slot);
+    postingCount_ += scratch_.size();
+    livePostings_ += scratch_.size();
+}
+
+// Drops stale postings by re-indexing every record except skipSlot, which
+// the caller is about to insert
+void TextSearchIndex::compactPostings(uint32_t skipSlot) {
+    postings_.clear();
+    postingCount_ = livePostings_ = 0;
+    for (uint32_t slot = 0; slot < records_.size(); ++slot) {
+        if (slot != skipSlot && !records_[slot].deleted) addPostings(slot);
+    }
+}
+
+void TextSearchIndex::insert(uint32_t slot) {
+    if (postingCount_ > 2 * livePostings_ + 65536) compactPostings(slot);
+    addPostings(slot);
+}
+
+void TextSearchIndex::erase(uint32_t slot) {
+    collectGrams(records_[slot], scratch_);
+    livePostings_ -= scratch_.size();
+}
+
+void TextSearchIndex::clear() {
+    postings_.clear();
+    postingCount_ = livePostings_ = 0;
+}
+
+void TextSearchIndex::remap(const vector<uint32_t>& newSlot) {
+    postingCount_ = 0;
+    for (auto it = postings_.begin(); it != postings_.end();) {
+        vector<uint32_t>& slots = it->second;
+        size_t kept = 0;
+        for (uint32_t slot : slots) {
+            if (slot < newSlot.size() && newSlot[slot] != StudentKeyIndex::NOT_FOUND) slots[kept++] = newSlot[slot];
+        }
+        slots.resize(kept);
+        postingCount_ += kept;
+        it = kept == 0 ? postings_.erase(it) : next(it);
+    }
+}
+
+size_t TextSearchIndex::search(string_view query, size_t limit, const function<void(uint32_t)>& visit) const {
+    string lower = toLowerCopy(query);
+    if (lower.empty() || limit == 0) return 0;
+    unordered_set<uint32_t> seen;
+    size_t prefixLength = min<size_t>(3, lower.size());
+    auto prefix = postings_.find(packGram(lower.data(), prefixLength, static_cast<uint32_t>(prefixLength)));
+    if (prefix != postings_.end()) {
+        for (uint32_t slot : prefix->second) {
+            if (slot >= records_.size() || records_[slot].deleted) continue;
+            if (!startsWithIgnoringCase(records_[slot].name, lower)) continue;
+            if (!seen.insert(slot).second) continue;
+            visit(slot);
+            if (seen.size() == limit) return limit;
+        }
+    }
+    if (lower.size() < 3) return seen.size();
+
+    // Every substring match contains each of the query's trigrams, so walking
+    // the shortest posting list and checking the records is enough
+    const vector<uint32_t>* shortest = nullptr;
+    for (size_t i = 0; i + 3 <= lower.size(); ++i) {
+        auto it = postings_.find(packGram(lower.data() + i, 3, 0));
+        if (it == postings_.end()) return seen.size();
+        if (!shortest || it->second.size() < shortest->size()) shortest = &it->second;
+    }
+    for (uint32_t slot : *shortest) {
+        if (slot >= records_.size() || records_[slot].deleted) continue; // Stale entry
+        const Student& s = records_[slot];
+        if (!containsIgnoringCase(s.name, lower) && !containsIgnoringCase(s.email, lower)) continue;
+        if (!seen.insert(slot).second) continue;
+        visit(slot);
+        if (seen.size() == limit) break;
+    }
+    return seen.size();
+}
+
+uint32_t findStudentSlot(string_view id) {
+    return studentIndex.find(id);
+}
+
+// Warns when the contact index kept an earlier student's phone number or
+// email instead of this record's. Callers check uniqueness first, so this only
+// fires for records that bypass the checks (journal replay of legacy data).
+void warnSharedContacts(uint32_t slot) {
+    const Student& s = students[slot];
+    uint32_t owner = phoneIndex.find(s.phoneNumber);
+    if (owner != StudentKeyIndex::NOT_FOUND && owner != slot) {
+        cerr << "Warning: " << s.studentID << " shares phone number " << s.phoneNumber << " with "
+             << students[owner].studentID << ". Only " << students[owner].studentID << " can be found by it.\n";
+    }
+    owner = emailIndex.find(s.email);
+    if (owner != StudentKeyIndex::NOT_FOUND && owner != slot) {
+        cerr << "Warning: " << s.studentID << " shares email " << s.email << " with "
+             << students[owner].studentID << ". Only " << students[owner].studentID << " can be found by it.\n";
+    }
+}
+
+// Appends a record and indexes it. Fails if the ID is already taken.
+bool insertStudentRecord(Student s) {
+    if (findStudentSlot(s.studentID) != StudentKeyIndex::NOT_FOUND) return false;
+    students.push_back(move(s));
+    uint32_t slot = static_cast<uint32_t>(students.size() - 1);
+    indexStudent(slot);
+    warnSharedContacts(slot);
+    return true;
+}
+
+// Overwrites the record in `slot`, keeping every index in step with the new values
+void replaceStudentRecord(uint32_t slot, Student updated) {
+    unindexStudent(slot);
+    students[slot] = move(updated);
+    indexStudent(slot);
+    warnSharedContacts(slot);
+}
+
+// Turns the record in `slot` into a tombstone. Only the ID and contact
+// indexes, the text index counters and the aggregates are updated; the rank
+// and marks sets keep the slot (their scans skip it), so no ordered-set erase
+// is paid per delete. The key fields stay so those sets remain ordered; the
+// other strings are freed.
+void tombstoneStudent(uint32_t slot) {
+    Student& s = students[slot];
+    storeVersion++;
+    noteCourseChanged(s.courseId);
+    studentIndex.erase(slot);
+    phoneIndex.erase(slot);
+    emailIndex.erase(slot);
+    textIndex.erase(slot);
+    admissionAggregates.remove(s);
+    for (string* field : {&s.name, &s.phoneNumber, &s.email, &s.address, &s.bloodGroup}) string().swap(*field);
+    s.deleted = true;
+    deadStudentCount++;
+}
+
+// Removes a record in O(1) by leaving a tombstone in its slot. No other record
+// moves; the slot is reclaimed by the next compactStudentSlots(). Callers
+// should follow up with compactStudentSlotsIfDue().
+bool removeStudentRecord(string_view id) {
+    uint32_t slot = findStudentSlot(id);
+    if (slot == StudentKeyIndex::NOT_FOUND) return false;
+    tombstoneStudent(slot);
+    return true;
+}
+
+size_t liveStudentCount() {
+    return students.size() - deadStudentCount;
+}
+
+// Rebuilds an ordered slot index after compaction. Dropping tombstones keeps
+// the relative order of the survivors, so every insert lands at the end and
+// nothing is re-sorted.
+template <typename SlotSet>
+void remapSlotSet(SlotSet& index, const vector<uint32_t>& newSlot) {
+    SlotSet remapped(index.key_comp());
+    for (uint32_t slot : index) {
+        if (newSlot[slot] != StudentKeyIndex::NOT_FOUND) remapped.emplace_hint(remapped.end(), newSlot[slot]);
+    }
+    index.swap(remapped);
+}
+
+// Drops every tombstone, keeping the live records in their current order.
+// Slots change, so the slot-keyed indexes are renumbered; the aggregates do
+// not refer to slots and are left alone.
+void compactStudentSlots() {
+    if (deadStudentCount == 0) return;
+    vector<uint32_t> newSlot(students.size(), StudentKeyIndex::NOT_FOUND);
+    uint32_t next = 0;
+    for (uint32_t slot = 0; slot < students.size(); ++slot) {
+        if (students[slot].deleted) continue;
+        if (slot != next) students[next] = move(students[slot]);
+        newSlot[slot] = next++;
+    }
+    students.resize(next);
+    deadStudentCount = 0;
+    storeVersion++;
+    studentIndex.rebuild([](uint32_t) {}); // Already reported when loaded
+    phoneIndex.rebuild([](uint32_t) {});
+    emailIndex.rebuild([](uint32_t) {});
+    remapSlotSet(rankIndex, newSlot); // Reads the moved records, so only after the loop above
+    remapSlotSet(marksIndex, newSlot);
+    textIndex.remap(newSlot);
+}
+
+// Compacts once tombstones make up TOMBSTONE_COMPACT_PERCENT of the slots, so
+// the rebuild is paid for by at least that many O(1) deletes
+void compactStudentSlotsIfDue() {
+    if (deadStudentCount * 100 >= students.size() * TOMBSTONE_COMPACT_PERCENT) compactStudentSlots();
+}
+
+// Tombstones every student admitted to courseId and returns how many. Their
+// IDs are appended to withdrawnIds, in slot order, if it is given.
+size_t withdrawCourseStudents(uint16_t courseId, vector<string>* withdrawnIds) {
+    size_t withdrawn = 0;
+    for (uint32_t slot = 0; slot < students.size(); ++slot) {
+        if (students[slot].deleted || students[slot].courseId != courseId) continue;
+        if (withdrawnIds) withdrawnIds->push_back(students[slot].studentID);
+        tombstoneStudent(slot);
+        withdrawn++;
+    }
+    compactStudentSlotsIfDue();
+    return withdrawn;
+}
+
+// Writes one student as a students.txt line (also used for journal entries)
+// Text fields are quoted when they need it (see writeCsvField).
+void writeStudentLine(ostream& out, const Student& s) {
+    for (const string* field : {&s.name, &s.phoneNumber, &s.email, &s.address, &s.bloodGroup, &s.studentID,
+                                &courseName(s), &admissionTypeName(s)}) {
+        writeCsvField(out, *field);
+        out << ",";
+    }
+    out << fixed << setprecision(2) << s.totalMarks << "," // Format double
+        << s.rankObtained << ","
+        << fixed << setprecision(2) << s.expectedPackage << "," // Format double
+        << fixed << setprecision(2) << s.feesPaid << "\n"; // Format double
+}
+
+// Writes records as a students.txt style file. Writes a temporary file first and
+// renames it over path, so a crash never leaves a half-written file.
+bool writeStudentsCsv(const string& path, const vector<Student>& records) {
+    const string tempFile = path + ".tmp";
+    ofstream outFile(tempFile);
+    if (!outFile.is_open()) {
+        cerr << "Error: Could not open " << tempFile << " for writing.\n";
+        return false;
+    }
+    for (const auto& s : records) {
+        if (!s.deleted) writeStudentLine(outFile, s);
+    }
+    outFile.close();
+    if (!outFile) {
+        cerr << "Error: Could not write " << tempFile << ".\n";
+        remove(tempFile.c_str());
+        return false;
+    }
+    return replaceFileDurably(tempFile, path);
+}
+
+// Flushes a file's data to disk (and on POSIX, a directory's entries). Returns
+// false if it could not be opened or synced.
+bool syncToDisk(const string& path) {
+#ifdef _WIN32
+    if (filesystem::is_directory(path)) return true; // Renames are flushed with the file on NTFS
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    bool ok = FlushFileBuffers(handle) != 0;
+    CloseHandle(handle);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
+// Moves a fully written temporary file over path: fsync the data, rename,
+// then fsync the directory so the rename itself survives a power cut
+bool replaceFileDurably(const string& tempFile, const string& path) {
+    if (!syncToDisk(tempFile)) {
+        cerr << "Error: Could not flush " << tempFile << " to disk.\n";
+        remove(tempFile.c_str());
+        return false;
+    }
+    error_code ec;
+    filesystem::rename(tempFile, path, ec);
+    if (ec) {
+        cerr << "Error: Could not replace " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+    filesystem::path directory = filesystem::absolute(path, ec).parent_path();
+    syncToDisk(directory.string()); // Best effort: the data itself is already durable
+    return true;
+}
+
+// Function to save students data to file
+bool saveStudentsToFile() {
+    if (!writeStudentsCsv(STUDENTS_FILE, students)) return false;
+    cout << "Students data saved successfully.\n";
+    return true;
+}
+
+// --- Mutation Journal ---
+// Each add, update and delete queues one line for students.journal instead of
+// rewriting the whole snapshot (students.txt or students.snap):
+//   A,<student line>   added
+//   U,<student line>   updated (matched by student ID)
+//   D,<student ID>     deleted
+//   W,<course name>    every student admitted to the course deleted
+//   S,<sequence>       change event sequence of the entry after it
+// Replaying the journal over the snapshot it was folded into gives that
+// snapshot again, so a crash between writing the snapshot and resetting the
+// journal only re-applies changes that are already saved. That holds because
+// a snapshot never saves a change made after entries it folds in: changes
+// saved only by a snapshot (bulk generation and repricing) empty the journal
+// first (see foldJournalBeforeBulkChange()).
+// The writer starts every batch with an S line; each entry after it has the
+// next sequence number, except that a W entry takes one per student it
+// withdraws (a D event each). Entries numbered past the last event in students.cdc
+// were committed but their events never published (a crash in between), so
+// replay publishes them.
+
+// Function to re-apply journal entries on top of the loaded snapshot
+void replayStudentJournal() {
+    // Events staged for a snapshot come before any in the journal
+    if (filesystem::exists(CDC_PENDING_FILE)) {
+        if (!ensureAllShardsLoaded()) {
+            cerr << "Error: Not replaying " << JOURNAL_FILE << ": a student shard could not be read. Changes are refused until a restart.\n";
+            journalHeldBack = true;
+            return;
+        }
+        lock_guard<mutex> fileGuard(journalWriter.fileLock());
+        changeStream.recoverStaged(isLoadedChange);
+    }
+    MappedFile file;
+    if (!file.open(JOURNAL_FILE)) return; // No journal yet
+    // Entries may touch any course: D has only a student ID, and U may move a
+    // student out of a course whose shard is still on disk. So a non-empty
+    // journal reads every shard at startup; a clean exit always compacts and
+    // leaves it empty, so this only costs anything after a crash.
+    if (file.size() > 0 && !ensureAllShardsLoaded()) {
+        cerr << "Error: Not replaying " << JOURNAL_FILE << ": a student shard could not be read. Changes are refused until a restart.\n";
+        journalHeldBack = true;
+        return;
+    }
+
+    StudentRowView row;
+    RowError error;
+    ParseErrorReport errors;
+    string_view fields[MAX_CSV_FIELDS];
+    int fieldCount;
+    int lineNumber = 0;
+    size_t applied = 0;
+    uint64_t published = file.size() > 0 ? changeStream.lastSequence() : 0;
+    uint64_t sequence = 0; // Of the next entry; 0 until an S line (journals written without them)
+    string missedEvents;
+    size_t missedCount = 0;
+    // Numbers the next change event; true if it never reached students.cdc
+    auto nextMissed = [&] {
+        bool missed = sequence != 0 && sequence++ > published;
+        missedCount += missed;
+        return missed;
+    };
+    const char* cursor = file.data();
+    const char* end = file.data() + file.size();
+    while (cursor < end) {
+        // A and U entries are CSV records, which may span lines inside quotes
+        const char* entryStart = cursor;
+        char op = *cursor;
+        bool isRecord = (op == 'A' || op == 'U') && end - cursor > 1 && cursor[1] == ',';
+        if (isRecord) {
+            cursor = splitCsvRecord(cursor + 2, end, fields, MAX_CSV_FIELDS, fieldCount);
+        } else {
+            const char* nl = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+            cursor = nl ? nl + 1 : end;
+        }
+        string_view line(entryStart, cursor - entryStart);
+        lineNumber++;
+        if (!line.empty() && line.back() == '\n') line.remove_suffix(1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+            if (isRecord && fieldCount <= MAX_CSV_FIELDS) fields[fieldCount - 1].remove_suffix(1);
+        }
+        if (line.empty()) continue;
+
+        if (!isRecord && (line.size() < 2 || line[1] != ',' || (op != 'D' && op != 'W' && op != 'S'))) {
+            cerr << "Error parsing " << JOURNAL_FILE << " at line " << lineNumber << ": Unknown journal entry. Full line: \"" << line << "\"\n";
+            continue;
+        }
+        if (op == 'S') {
+            if (parseNumber(line.substr(2), sequence) != FieldStatus::Ok) {
+                cerr << "Error parsing " << JOURNAL_FILE << " at line " << lineNumber << ": Bad sequence number. Full line: \"" << line << "\"\n";
+                sequence = 0;
+            }
+            continue;
+        }
+        if (op == 'D') {
+            removeStudentRecord(line.substr(2)); // Already gone is fine
+            if (nextMissed()) missedEvents += changeStream.encode('D', line.substr(2));
+            applied++;
+            continue;
+        }
+        if (op == 'W') {
+            // Replay withdraws the same students in the same order, one event each
+            vector<string> withdrawnIds;
+            uint16_t courseId = courseNames.find(line.substr(2));
+            if (courseId != StringDictionary::NOT_FOUND) withdrawCourseStudents(courseId, &withdrawnIds);
+            for (const string& id : withdrawnIds) {
+                if (nextMissed()) missedEvents += changeStream.encode('D', id);
+            }
+            applied++;
+            continue;
+        }
+        bool missed = nextMissed();
+        if (parseStudentFields(fields, fieldCount, row, error)) {
+            Student s = materializeStudent(row, courseNames, admissionTypes);
+            if (!hasDictionaryIds(s, error)) {
+                errors.add(error, lineNumber, line);
+                continue;
+            }
+            uint32_t slot = findStudentSlot(s.studentID);
+            if (slot == StudentKeyIndex::NOT_FOUND) {
+                insertStudentRecord(move(s));
+                slot = static_cast<uint32_t>(students.size() - 1);
+            } else {
+                replaceStudentRecord(slot, move(s));
+            }
+            if (missed) missedEvents += changeStream.encode(op, students[slot]);
+        } else {
+            errors.add(error, lineNumber, line);
+            continue;
+        }
+        applied++;
+    }
+    errors.print(cerr, JOURNAL_FILE, STUDENT_FIELD_NAMES);
+    if (missedCount > 0) {
+        // Encoded in journal order right after the last published event, so
+        // they get the sequence numbers they were first given
+        lock_guard<mutex> fileGuard(journalWriter.fileLock());
+        if (changeStream.write(missedEvents)) {
+            cout << "Published " << missedCount << " change event(s) that a crash kept out of " << CDC_FILE << ".\n";
+        }
+    }
+    compactStudentSlotsIfDue();
+    journalEntryCount = applied; // Blank, malformed and S lines do not count toward compaction
+    if (applied > 0) {
+        cout << "Replayed " << applied << " journal entries.\n";
+    }
+}
+
+// Records an add ('A') or update ('U') of s in the journal
+void journalStudentWrite(char op, const Student& s) {
+    ostringstream entry;
+    entry << op << ",";
+    writeStudentLine(entry, s);
+    journalWriter.append(entry.str(), changeStream.encode(op, s));
+}
+
+void journalStudentDelete(const string& id) {
+    journalWriter.append("D," + id + "\n", changeStream.encode('D', id));
+}
+
+// One journal entry stands for the whole course, however many students it
+// held. Consumers get a D event per student, so they learn each removed ID.
+void journalCourseWithdrawal(const string& course, const vector<string>& withdrawnIds) {
+    string events;
+    for (const string& id : withdrawnIds) events += changeStream.encode('D', id);
+    journalWriter.append("W," + course + "\n", move(events));
+}
+
+// Function to fold the journal into a fresh snapshot and start a new journal.
+// The caller must keep records from changing: the only thread making changes,
+// or a holder of storeMutex. The change events of the queued journal lines,
+// and an op event for each of slots (bulk changes saved by the snapshot
+// instead of journaled), are staged before the snapshot is written and
+// published after, so a crash in between loses none of them. Returns false
+// if no snapshot was saved; the journal and queued lines are then kept and
+// slots get no events.
+bool compactStudentStore(char op, const vector<uint32_t>& slots) {
+    lock_guard<mutex> fileGuard(journalWriter.fileLock());
+    if (!changeStream.stage(journalWriter.queuedEvents(), op, slots)) return false;
+    if (!saveStudentStore(!journalWriter.runningOnThisThread())) {
+        changeStream.dropStaged();
+        return false; // Keep the journal, it is still the only copy of recent changes
+    }
+    journalWriter.discardQueued();
+    changeStream.publishStaged(); // On failure kept for retry; a crash leaves them staged for the next start
+    journalOut.close();
+    // An empty journal renamed into place: a plain truncate may not reach
+    // the disk before the snapshot rename does
+    const string emptyJournal = JOURNAL_FILE + ".tmp";
+    ofstream reset(emptyJournal, ios::trunc);
+    reset.close();
+    if (reset && replaceFileDurably(emptyJournal, JOURNAL_FILE)) {
+        journalEntryCount = 0;
+    } else {
+        cerr << "Error: Could not reset " << JOURNAL_FILE << "; its entries will be replayed again.\n";
+    }
+    return true;
+}
+
+bool compactStudentStore() {
+    return compactStudentStore(0, {});
+}
+
+// Folds the journal into a snapshot before a bulk change that will be saved
+// by a snapshot alone. Left in the journal, its entries would be replayed
+// over that snapshot after a crash before the journal reset, e.g. an old U
+// line undoing a repricing. The caller must keep records from changing and
+// call this before changing any. Returns false if the journal is still not
+// empty; the bulk change must then be journaled row by row.
+bool foldJournalBeforeBulkChange() {
+    auto journalEmpty = [] {
+        lock_guard<mutex> fileGuard(journalWriter.fileLock()); // The writer takes its batch under this
+        error_code ec;
+        uintmax_t size = filesystem::file_size(JOURNAL_FILE, ec);
+        return (ec || size == 0) && !journalWriter.hasQueued();
+    };
+    if (journalEmpty()) return true;
+    compactStudentStore();
+    return journalEmpty();
+}
+
+// Commits queued journal lines, stops the writer thread and compacts. Every
+// way of exiting the program goes through here.
+void shutdownStudentStore() {
+    journalWriter.stop();
+    compactStudentStore();
+}
+
+// --- Background Writer ---
+// Changes only queue their journal line, so the operator never waits on the
+// disk. The writer thread appends everything queued in one write followed by
+// one fsync (group commit), every COMMIT_INTERVAL_MS or as soon as
+// COMMIT_BATCH_ENTRIES lines are waiting. Once the journal holds
+// JOURNAL_COMPACT_THRESHOLD entries the same thread folds it into a new
+// snapshot under a shared lock on storeMutex, so every code path that
+// changes records while the writer may be running must hold storeMutex
+// exclusively. The writer only ever try-locks storeMutex, and a thread
+// holding it can therefore compact or stop the writer without deadlocking.
+
+size_t readCommitSetting(const char* name, size_t fallback) {
+    const char* text = getenv(name);
+    size_t value = 0;
+    if (text == nullptr || from_chars(text, text + strlen(text), value).ec != errc() || value == 0) return fallback;
+    return value;
+}
+
+void JournalWriter::append(string line, string events) {
+    lock_guard<mutex> lock(queueLock_);
+    if (!thread_.joinable()) {
+        // Started on first use, so one-shot tools never spawn it
+        interval_ = chrono::milliseconds(readCommitSetting("UGC_COMMIT_INTERVAL_MS", COMMIT_INTERVAL_MS));
+        batchEntries_ = readCommitSetting("UGC_COMMIT_BATCH_ENTRIES", COMMIT_BATCH_ENTRIES);
+        stopping_ = false;
+        thread_ = thread(&JournalWriter::run, this);
+    }
+    queue_.push_back(move(line));
+    events_ += events;
+    if (queue_.size() >= batchEntries_) wake_.notify_one();
+}
+
+void JournalWriter::stop() {
+    {
+        lock_guard<mutex> lock(queueLock_);
+        if (!thread_.joinable()) return;
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+string JournalWriter::queuedEvents() {
+    lock_guard<mutex> lock(queueLock_);
+    return events_;
+}
+
+bool JournalWriter::hasQueued() {
+    lock_guard<mutex> lock(queueLock_);
+    return !queue_.empty();
+}
+
+void JournalWriter::discardQueued() {
+    lock_guard<mutex> lock(queueLock_);
+    queue_.clear();
+    events_.clear();
+    compactNow_ = false;
+}
+
+bool JournalWriter::runningOnThisThread() const {
+    return thread_.get_id() == this_thread::get_id();
+}
+
+// Appends one batch to the journal with a single write and fsync, after an
+// S line with the sequence of the batch's first change event
+bool JournalWriter::commit(const vector<string>& batch, uint64_t firstSequence) {
+    if (!journalOut.is_open()) {
+        journalOut.open(JOURNAL_FILE, ios::app);
+        if (!journalOut.is_open()) {
+            cerr << "Error: Could not open journal file. Saving full students file instead.\n";
+            return false;
+        }
+    }
+    string block;
+    if (firstSequence != 0) block = "S," + to_string(firstSequence) + "\n";
+    for (const string& line : batch) block += line;
+    journalOut << block;
+    journalOut.flush();
+    if (!journalOut || !syncToDisk(JOURNAL_FILE)) {
+        cerr << "Error: Could not write journal file. Saving full students file instead.\n";
+        journalOut.close();
+        return false;
+    }
+    journalEntryCount += batch.size();
+    return true;
+}
+
+// Folds the journal into the snapshot when it is long enough, unless records
+// are being changed right now (then the next wake-up tries again)
+void JournalWriter::compactIfDue(bool force) {
+    {
+        lock_guard<mutex> file(fileLock_);
+        if (journalEntryCount < JOURNAL_COMPACT_THRESHOLD && !force) return;
+    }
+    shared_lock<shared_mutex> store(storeMutex, try_to_lock);
+    if (!store.owns_lock()) return;
+    compactStudentStore();
+}
+
+void JournalWriter::run() {
+    unique_lock<mutex> lock(queueLock_);
+    while (true) {
+        wake_.wait_for(lock, interval_, [this] { return stopping_ || queue_.size() >= batchEntries_; });
+        if (!queue_.empty()) {
+            lock.unlock();
+            // Take fileLock_ before the batch, in the order compactStudentStore
+            // uses. A compaction can then never run between taking the batch
+            // and appending it; it would discard lines queued after the batch
+            // and truncate the journal, and the stale batch would land in the
+            // fresh journal and be replayed over the newer snapshot.
+            lock_guard<mutex> file(fileLock_);
+            lock.lock();
+            vector<string> batch;
+            batch.swap(queue_);
+            string events;
+            events.swap(events_);
+            lock.unlock();
+            bool written = batch.empty() || commit(batch, ChangeStream::firstSequence(events)); // A compaction may have taken them all meanwhile
+            if (written) changeStream.write(events); // Kept and retried on failure, the journal backs them meanwhile
+            lock.lock();
+            if (!written) {
+                // Keep the lines in order ahead of anything queued since, and
+                // fall back to writing a whole snapshot
+                queue_.insert(queue_.begin(), make_move_iterator(batch.begin()), make_move_iterator(batch.end()));
+                events_.insert(0, events);
+                compactNow_ = true;
+            }
+        }
+        if (stopping_) break; // The caller compacts after stop()
+        bool force = compactNow_;
+        lock.unlock();
+        if (changeStream.hasUnwritten()) { // An earlier write failed: retry, oldest events first
+            lock_guard<mutex> file(fileLock_);
+            changeStream.write(string());
+        }
+        compactIfDue(force);
+        lock.lock();
+    }
+}
+
+// --- Change Data Capture ---
+// Every journaled change also produces a binary event (see ChangeStream). The
+// journal writer publishes a batch's events right after the batch is fsynced,
+// and a snapshot publishes the events of whatever it made durable, so events
+// reach students.cdc in sequence order. Bulk operations that write a snapshot
+// instead of journaling (generate, large reprices) hand their records to
+// compactStudentStore, which stages the events in students.cdc.pending before
+// the snapshot. Consumers run ex2 --cdc-tail <checkpoint>. If the program dies
+// between fsyncing a batch and publishing its events, journal replay publishes
+// them on the next start (see the Mutation Journal section); if it dies after
+// staging, ChangeStream::recoverStaged() does.
+
+uint32_t fnv1a(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    return hash;
+}
+
+template <typename T>
+void appendRaw(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendText(string& out, string_view text) {
+    appendRaw(out, static_cast<uint32_t>(text.size()));
+    out.append(text.data(), text.size());
+}
+
+// Reads a T at p if it fits before end, advancing p
+template <typename T>
+bool readRaw(const char*& p, const char* end, T& value) {
+    if (static_cast<size_t>(end - p) < sizeof(T)) return false;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+bool readText(const char*& p, const char* end, string_view& text) {
+    uint32_t size;
+    if (!readRaw(p, end, size) || static_cast<size_t>(end - p) < size) return false;
+    text = string_view(p, size);
+    p += size;
+    return true;
+}
+
+// Decodes the complete, intact events at the start of [data, data + size),
+// calling visit for each; returns the bytes they take. Stops at a partly
+// written or damaged event, which a writer truncates on its next start.
+size_t parseChangeEvents(const char* data, size_t size, const function<void(const ChangeEvent&)>& visit) {
+    const char* p = data;
+    const char* end = data + size;
+    while (true) {
+        const char* start = p;
+        uint32_t eventSize;
+        if (!readRaw(p, end, eventSize) || eventSize < sizeof(uint64_t) + 1 + sizeof(uint32_t) ||
+            static_cast<size_t>(end - p) < eventSize) {
+            return start - data;
+        }
+        const char* body = p;
+        const char* bodyEnd = p + eventSize - sizeof(uint32_t);
+        uint32_t checksum;
+        memcpy(&checksum, bodyEnd, sizeof(checksum));
+        if (fnv1a(body, bodyEnd - body) != checksum) return start - data;
+
+        ChangeEvent e;
+        bool ok = readRaw(p, bodyEnd, e.sequence) && readRaw(p, bodyEnd, e.op);
+        if (ok && (e.op == 'A' || e.op == 'U')) {
+            for (int f = 0; f < CDC_TEXT_FIELDS && ok; ++f) ok = readText(p, bodyEnd, e.text[f]);
+            ok = ok && readRaw(p, bodyEnd, e.totalMarks) && readRaw(p, bodyEnd, e.expectedPackage) &&
+                 readRaw(p, bodyEnd, e.feesPaid) && readRaw(p, bodyEnd, e.rankObtained);
+        } else if (ok && (e.op == 'D' || e.op == 'W')) {
+            ok = readText(p, bodyEnd, e.text[0]);
+        } else {
+            ok = false;
+        }
+        if (!ok || p != bodyEnd) return start - data;
+        visit(e);
+        p = bodyEnd + sizeof(uint32_t);
+    }
+}
+
+void ChangeStream::open() {
+    opened_ = true;
+    MappedFile file;
+    size_t validEnd = sizeof(CDC_MAGIC);
+    if (file.open(CDC_FILE) && file.size() > 0) {
+        if (file.size() < sizeof(CDC_MAGIC) || memcmp(file.data(), CDC_MAGIC, sizeof(CDC_MAGIC)) != 0) {
+            cerr << "Error: " << CDC_FILE << " is not a change stream. No change events will be written.\n";
+            disabled_ = true;
+            return;
+        }
+        validEnd += parseChangeEvents(file.data() + sizeof(CDC_MAGIC), file.size() - sizeof(CDC_MAGIC),
+                                      [this](const ChangeEvent& e) { lastSequence_ = e.sequence; });
+        if (validEnd < file.size()) {
+            cerr << "Warning: Dropping " << file.size() - validEnd << " bytes of an unfinished event from the end of "
+                 << CDC_FILE << ".\n";
+        }
+    }
+    size_t existing = file.size();
+    file.close();
+    if (existing > validEnd) {
+        error_code ec;
+        filesystem::resize_file(CDC_FILE, validEnd, ec);
+    }
+    out_.open(CDC_FILE, ios::binary | ios::app);
+    if (existing == 0) out_.write(CDC_MAGIC, sizeof(CDC_MAGIC)).flush(); // On disk before size_ counts it
+    size_ = validEnd;
+    if (!out_) {
+        cerr << "Error: Could not open " << CDC_FILE << ". No change events will be written.\n";
+        disabled_ = true;
+    }
+}
+
+string ChangeStream::begin(char op) {
+    lock_guard<mutex> lock(lock_);
+    if (!opened_) open();
+    string event;
+    appendRaw(event, uint32_t(0)); // Size, filled in by finish()
+    appendRaw(event, ++lastSequence_);
+    appendRaw(event, op);
+    return event;
+}
+
+void ChangeStream::finish(string& event) {
+    uint32_t checksum = fnv1a(event.data() + sizeof(uint32_t), event.size() - sizeof(uint32_t));
+    appendRaw(event, checksum);
+    uint32_t size = static_cast<uint32_t>(event.size() - sizeof(uint32_t));
+    memcpy(&event[0], &size, sizeof(size));
+}
+
+string ChangeStream::encode(char op, const Student& s) {
+    uint64_t sequence;
+    {
+        lock_guard<mutex> lock(lock_);
+        if (!opened_) open();
+        sequence = ++lastSequence_;
+    }
+    return encodeStudent(sequence, op, s);
+}
+
+string ChangeStream::encode(char op, string_view key) {
+    string event = begin(op);
+    appendText(event, key);
+    finish(event);
+    return event;
+}
+
+uint64_t ChangeStream::lastSequence() {
+    lock_guard<mutex> lock(lock_);
+    if (!opened_) open();
+    return lastSequence_;
+}
+
+uint64_t ChangeStream::firstSequence(const string& events) {
+    uint64_t sequence = 0;
+    if (events.size() >= sizeof(uint32_t) + sizeof(sequence)) memcpy(&sequence, events.data() + sizeof(uint32_t), sizeof(sequence));
+    return sequence;
+}
+
+// Appends and fsyncs. A failed write is cut off again, so the file never
+// holds part of an event followed by later ones.
+bool ChangeStream::append(const char* data, size_t size) {
+    if (size == 0) return true;
+    out_.write(data, size);
+    out_.flush();
+    if (out_ && syncToDisk(CDC_FILE)) {
+        size_ += size;
+        return true;
+    }
+    cerr << "Error: Could not write change events to " << CDC_FILE << ". They will be written with the next ones.\n";
+    out_.close();
+    error_code ec;
+    filesystem::resize_file(CDC_FILE, size_, ec);
+    out_.clear();
+    out_.open(CDC_FILE, ios::binary | ios::app);
+    return false;
+}
+
+bool ChangeStream::flush() {
+    if (staged_) {
+        MappedFile file;
+        if (!file.open(CDC_PENDING_FILE) || !append(file.data(), file.size())) return false;
+        file.close();
+        remove(CDC_PENDING_FILE.c_str());
+        staged_ = false;
+    }
+    if (!append(unwritten_.data(), unwritten_.size())) return false;
+    unwritten_.clear();
+    return true;
+}
+
+bool ChangeStream::write(const string& events) {
+    lock_guard<mutex> lock(lock_);
+    if (!opened_) open();
+    if (disabled_) return false;
+    unwritten_ += events;
+    return flush();
+}
+
+bool ChangeStream::hasUnwritten() {
+    lock_guard<mutex> lock(lock_);
+    return staged_ || !unwritten_.empty();
+}
+
+string ChangeStream::encodeStudent(uint64_t sequence, char op, const Student& s) {
+    string event;
+    appendRaw(event, uint32_t(0));
+    appendRaw(event, sequence);
+    appendRaw(event, op);
+    for (string_view text : {string_view(s.studentID), string_view(s.name), string_view(s.phoneNumber),
+                             string_view(s.email), string_view(s.address), string_view(s.bloodGroup),
+                             string_view(courseName(s)), string_view(admissionTypeName(s))}) {
+        appendText(event, text);
+    }
+    appendRaw(event, s.totalMarks);
+    appendRaw(event, s.expectedPackage);
+    appendRaw(event, s.feesPaid);
+    appendRaw(event, static_cast<int32_t>(s.rankObtained));
+    finish(event);
+    return event;
+}
+
+bool ChangeStream::stage(const string& queued, char op, const vector<uint32_t>& slots) {
+    lock_guard<mutex> lock(lock_);
+    if (!opened_) open();
+    if (disabled_) return true; // Nothing is published, so nothing can be lost
+    // Older events are only backed by the journal that the snapshot is about
+    // to replace. Until they are written, keep the journal.
+    if (!flush()) {
+        cerr << "Error: Not saving a snapshot until the unwritten change events are in " << CDC_FILE << ".\n";
+        return false;
+    }
+    stagedFrom_ = lastSequence_;
+    if (queued.empty() && slots.empty()) return true;
+    const string tempFile = CDC_PENDING_FILE + ".tmp";
+    ofstream out(tempFile, ios::binary | ios::trunc);
+    out.write(queued.data(), queued.size());
+    string block; // Encoded a block at a time to bound memory
+    for (uint32_t slot : slots) {
+        block += encodeStudent(++lastSequence_, op, students[slot]);
+        if (block.size() >= (1 << 20)) {
+            out.write(block.data(), block.size());
+            block.clear();
+        }
+    }
+    out.write(block.data(), block.size());
+    out.close();
+    if (!out || !replaceFileDurably(tempFile, CDC_PENDING_FILE)) {
+        cerr << "Error: Could not write " << CDC_PENDING_FILE << ".\n";
+        remove(tempFile.c_str());
+        lastSequence_ = stagedFrom_;
+        return false;
+    }
+    staged_ = true;
+    return true;
+}
+
+bool ChangeStream::publishStaged() {
+    lock_guard<mutex> lock(lock_);
+    return !staged_ || flush();
+}
+
+void ChangeStream::dropStaged() {
+    lock_guard<mutex> lock(lock_);
+    if (staged_) remove(CDC_PENDING_FILE.c_str());
+    staged_ = false;
+    lastSequence_ = stagedFrom_; // Nothing numbered since was kept
+}
+
+void ChangeStream::recoverStaged(const function<bool(const ChangeEvent&)>& isLoaded) {
+    MappedFile file;
+    if (!file.open(CDC_PENDING_FILE)) return;
+    lock_guard<mutex> lock(lock_);
+    if (!opened_) open();
+    // The snapshot was saved if some events already reached students.cdc, or
+    // if the records hold the last change of every key
+    bool saved = false;
+    map<string, const ChangeEvent*> last; // "S" + student ID or "W" + course -> its last event
+    vector<ChangeEvent> events;
+    size_t valid = parseChangeEvents(file.data(), file.size(), [&events](const ChangeEvent& e) { events.push_back(e); });
+    size_t firstUnwritten = events.size();
+    for (size_t i = 0; i < events.size(); ++i) {
+        if (events[i].sequence <= lastSequence_) saved = true;
+        else if (firstUnwritten == events.size()) firstUnwritten = i;
+        last[(events[i].op == 'W' ? "W" : "S") + string(events[i].text[0])] = &events[i];
+    }
+    if (!saved) {
+        saved = !events.empty();
+        for (const auto& entry : last) saved = saved && isLoaded(*entry.second);
+    }
+    if (!disabled_ && saved && firstUnwritten < events.size()) {
+        // Offsets of the unwritten events: each is 4 bytes of size plus its body
+        const char* p = file.data();
+        for (size_t i = 0; i < firstUnwritten; ++i) {
+            uint32_t size;
+            memcpy(&size, p, sizeof(size));
+            p += sizeof(size) + size;
+        }
+        lastSequence_ = events.back().sequence;
+        if (!append(p, file.data() + valid - p)) {
+            // The next write retries them. The file stays until then: once
+            // they are written, the next start finds nothing left to publish.
+            unwritten_.assign(p, file.data() + valid - p);
+            return;
+        }
+        cout << "Published " << events.size() - firstUnwritten << " change event(s) that a crash kept out of " << CDC_FILE << ".\n";
+    }
+    file.close();
+    remove(CDC_PENDING_FILE.c_str());
+}
+
+// Whether the loaded records show e's change: an added or updated student as
+// the event has it, a deleted student gone, a withdrawn course empty
+bool isLoadedChange(const ChangeEvent& e) {
+    uint32_t slot = findStudentSlot(e.text[0]);
+    if (e.op == 'D') return slot == StudentKeyIndex::NOT_FOUND;
+    if (e.op == 'W') {
+        uint16_t courseId = courseNames.find(e.text[0]);
+        return courseId == StringDictionary::NOT_FOUND || admissionAggregates.byCourse(courseId).count == 0;
+    }
+    if (slot == StudentKeyIndex::NOT_FOUND) return false;
+    const Student& s = students[slot];
+    string_view fields[CDC_TEXT_FIELDS] = {s.studentID, s.name, s.phoneNumber, s.email, s.address, s.bloodGroup,
+                                           courseName(s), admissionTypeName(s)};
+    return equal(fields, fields + CDC_TEXT_FIELDS, e.text) && s.totalMarks == e.totalMarks &&
+           s.expectedPackage == e.expectedPackage && s.feesPaid == e.feesPaid && s.rankObtained == e.rankObtained;
+}
+
+// Reads "<sequence> <offset>" from a consumer checkpoint; a missing file means
+// start from the first event
+bool readChangeCheckpoint(const string& path, uint64_t& sequence, uint64_t& offset) {
+    sequence = 0;
+    offset = sizeof(CDC_MAGIC);
+    ifstream in(path);
+    if (!in.is_open()) return true;
+    return static_cast<bool>(in >> sequence >> offset) && offset >= sizeof(CDC_MAGIC);
+}
+
+bool writeChangeCheckpoint(const string& path, uint64_t sequence, uint64_t offset) {
+    string tempFile = path + ".tmp";
+    {
+        ofstream out(tempFile, ios::trunc);
+        out << sequence << ' ' << offset << '\n';
+        if (!out) return false;
+    }
+    return replaceFileDurably(tempFile, path);
+}
+
+// Consumer side: prints the events after the checkpoint as
+//   <sequence>,A|U,<student fields as in students.txt>
+//   <sequence>,D,<student ID>   or   <sequence>,W,<course>
+// then moves the checkpoint past them. The checkpoint is written after the
+// events are printed, so a consumer that dies in between sees them again
+// (at-least-once delivery). With --follow it keeps polling for new events.
+int runChangeTail(const string& checkpointPath, bool follow) {
+    uint64_t sequence, offset;
+    if (!readChangeCheckpoint(checkpointPath, sequence, offset)) {
+        cerr << "Error: " << checkpointPath << " is not a change stream checkpoint.\n";
+        return 1;
+    }
+    while (true) {
+        ifstream in(CDC_FILE, ios::binary);
+        char magic[sizeof(CDC_MAGIC)] = {};
+        if (in.is_open() && in.read(magic, sizeof(magic)) && memcmp(magic, CDC_MAGIC, sizeof(magic)) != 0) {
+            cerr << "Error: " << CDC_FILE << " is not a change stream.\n";
+            return 1;
+        }
+        string buffer;
+        if (in && in.seekg(static_cast<streamoff>(offset))) {
+            buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }
+        bool mismatch = false;
+        size_t consumed;
+        {
+            OutputBuffer out(cout);
+            consumed = parseChangeEvents(buffer.data(), buffer.size(), [&](const ChangeEvent& e) {
+                if (mismatch || e.sequence != sequence + 1) {
+                    mismatch = true;
+                    return;
+                }
+                sequence = e.sequence;
+                out << e.sequence << ',' << e.op << ',';
+                if (e.op == 'A' || e.op == 'U') {
+                    ostringstream line; // Same field order and quoting as students.txt
+                    for (string_view field : {e.text[1], e.text[2], e.text[3], e.text[4], e.text[5], e.text[0],
+                                              e.text[6], e.text[7]}) {
+                        writeCsvField(line, field);
+                        line << ',';
+                    }
+                    out << line.str();
+                    out.fixed(e.totalMarks) << ',' << e.rankObtained << ',';
+                    out.fixed(e.expectedPackage) << ',';
+                    out.fixed(e.feesPaid) << '\n';
+                } else {
+                    out << e.text[0] << '\n';
+                }
+            });
+        }
+        cout.flush();
+        if (mismatch) {
+            cerr << "Error: " << CDC_FILE << " does not continue from event " << sequence << " of " << checkpointPath
+                 << ". Was the stream replaced?\n";
+            return 1;
+        }
+        if (consumed > 0) {
+            offset += consumed;
+            if (!writeChangeCheckpoint(checkpointPath, sequence, offset)) {
+                cerr << "Error: Could not write checkpoint " << checkpointPath << ".\n";
+                return 1;
+            }
+        }
+        if (!follow) break;
+        this_thread::sleep_for(chrono::milliseconds(COMMIT_INTERVAL_MS));
+    }
+    return 0;
+}
+
+// --- Binary Snapshot ---
+
+bool StudentSnapshot::open(const string& path, string& error) {
+    if (!file_.open(path)) {
+        error = "could not be opened";
+        return false;
+    }
+    const char* base = file_.data();
+    size_t fileSize = file_.size();
+    if (fileSize < sizeof(SnapshotHeader)) {
+        error = "file is too short";
+        return false;
+    }
+    SnapshotHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        error = "not a student snapshot";
+        return false;
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        error = "unsupported snapshot version " + to_string(header.version);
+        return false;
+    }
+    if (header.columnCount < SNAPSHOT_COLUMN_COUNT ||
+        header.columnCount > (fileSize - sizeof(SnapshotHeader)) / sizeof(SnapshotColumnEntry)) {
+        error = "column directory is missing or truncated";
+        return false;
+    }
+    rowCount_ = header.rowCount;
+    const SnapshotColumnEntry* directory = reinterpret_cast<const SnapshotColumnEntry*>(base + sizeof(SnapshotHeader));
+
+    for (uint32_t c = 0; c < SNAPSHOT_COLUMN_COUNT; ++c) {
+        const SnapshotColumnEntry& entry = directory[c];
+        if (entry.offset % 8 != 0 || entry.offset > fileSize || entry.size > fileSize - entry.offset) {
+            error = "column " + to_string(c) + " lies outside the file";
+            return false;
+        }
+        const char* column = base + entry.offset;
+        // rowCount comes from the file, so compare it by division before
+        // multiplying: a huge count must not wrap into a small byte size
+        if (c < SNAPSHOT_STRING_COLUMNS) {
+            if (rowCount_ >= entry.size / sizeof(uint64_t)) {
+                error = "column " + to_string(c) + " is truncated";
+                return false;
+            }
+            uint64_t offsetBytes = (rowCount_ + 1) * sizeof(uint64_t);
+            const uint64_t* offsets = reinterpret_cast<const uint64_t*>(column);
+            bool ordered = offsets[0] == 0 && offsets[rowCount_] <= entry.size - offsetBytes;
+            for (size_t row = 0; ordered && row < rowCount_; ++row) ordered = offsets[row] <= offsets[row + 1];
+            if (!ordered) {
+                error = "column " + to_string(c) + " has bad string offsets";
+                return false;
+            }
+            stringOffsets_[c] = offsets;
+            stringData_[c] = column + offsetBytes;
+        } else {
+            size_t width = (c == COL_RANK) ? sizeof(int32_t) : sizeof(double);
+            if (rowCount_ > entry.size / width) {
+                error = "column " + to_string(c) + " is truncated";
+                return false;
+            }
+        }
+    }
+    totalMarks_ = reinterpret_cast<const double*>(base + directory[COL_TOTAL_MARKS].offset);
+    rankObtained_ = reinterpret_cast<const int32_t*>(base + directory[COL_RANK].offset);
+    expectedPackage_ = reinterpret_cast<const double*>(base + directory[COL_PACKAGE].offset);
+    feesPaid_ = reinterpret_cast<const double*>(base + directory[COL_FEES].offset);
+    return true;
+}
+
+Student StudentSnapshot::materialize(size_t row, StringDictionary& courseDictionary, StringDictionary& typeDictionary) const {
+    Student s;
+    s.name.assign(text(COL_NAME, row));
+    s.phoneNumber.assign(text(COL_PHONE, row));
+    s.email.assign(text(COL_EMAIL, row));
+    s.address.assign(text(COL_ADDRESS, row));
+    s.bloodGroup.assign(text(COL_BLOOD_GROUP, row));
+    s.studentID.assign(text(COL_STUDENT_ID, row));
+    s.courseId = courseDictionary.intern(text(COL_COURSE, row));
+    s.admissionTypeId = typeDictionary.intern(text(COL_ADMISSION_TYPE, row));
+    s.totalMarks = totalMarks_[row];
+    s.rankObtained = rankObtained_[row];
+    s.expectedPackage = expectedPackage_[row];
+    s.feesPaid = feesPaid_[row];
+    return s;
+}
+
+// Loads a binary snapshot into out. Rows are copied out of the mapping on one
+// worker thread per core.
+bool readStudentSnapshot(const string& path, vector<Student>& out) {
+    StudentSnapshot snapshot;
+    string error;
+    if (!snapshot.open(path, error)) {
+        cerr << "Error: Could not load " << path << ": " << error << ".\n";
+        return false;
+    }
+    size_t rows = snapshot.rowCount();
+    out.clear();
+    out.resize(rows);
+    size_t threadCount = max(1u, thread::hardware_concurrency());
+    threadCount = max<size_t>(1, min(threadCount, rows / 65536));
+    auto copyRows = [&snapshot, &out](size_t first, size_t last, StringDictionary& localCourses, StringDictionary& localTypes) {
+        for (size_t row = first; row < last; ++row) out[row] = snapshot.materialize(row, localCourses, localTypes);
+    };
+    vector<StringDictionary> localCourses(threadCount), localTypes(threadCount);
+    if (threadCount == 1) {
+        copyRows(0, rows, localCourses[0], localTypes[0]);
+    } else {
+        vector<thread> workers;
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back(copyRows, rows * i / threadCount, rows * (i + 1) / threadCount, ref(localCourses[i]), ref(localTypes[i]));
+        }
+        for (auto& w : workers) w.join();
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        adoptDictionaryIds(out.data() + rows * i / threadCount, out.data() + rows * (i + 1) / threadCount, localCourses[i], localTypes[i]);
+    }
+    dropStudentsWithBadNumbers(out, 0, path);
+    if (size_t dropped = dropStudentsWithoutIds(out, 0)) {
+        cerr << "Error: Skipped " << dropped << " record(s) in " << path << ": too many distinct course or admission type names.\n";
+    }
+    return true;
+}
+
+// Writes records as a binary snapshot, via a temporary file and rename
+bool writeStudentSnapshot(const string& path, const vector<Student>& records) {
+    vector<const Student*> live; // Tombstones are not saved
+    live.reserve(records.size());
+    for (const auto& s : records) {
+        if (!s.deleted) live.push_back(&s);
+    }
+    return writeStudentSnapshotRows(path, live);
+}
+
+// Writes the given records, in order, as a binary snapshot
+bool writeStudentSnapshotRows(const string& path, const vector<const Student*>& live) {
+    const uint64_t rows = live.size();
+    auto field = [](const Student& s, uint32_t column) -> const string& {
+        switch (column) {
+            case COL_NAME: return s.name;
+            case COL_PHONE: return s.phoneNumber;
+            case COL_EMAIL: return s.email;
+            case COL_ADDRESS: return s.address;
+            case COL_BLOOD_GROUP: return s.bloodGroup;
+            case COL_STUDENT_ID: return s.studentID;
+            case COL_COURSE: return courseName(s);
+            default: return admissionTypeName(s);
+        }
+    };
+    auto align8 = [](uint64_t n) { return (n + 7) & ~uint64_t(7); };
+
+    // Lay out every column before writing anything
+    SnapshotColumnEntry directory[SNAPSHOT_COLUMN_COUNT];
+    uint64_t offset = align8(sizeof(SnapshotHeader) + sizeof(directory));
+    for (uint32_t c = 0; c < SNAPSHOT_COLUMN_COUNT; ++c) {
+        uint64_t size;
+        if (c < SNAPSHOT_STRING_COLUMNS) {
+            size = (rows + 1) * sizeof(uint64_t);
+            for (const Student* s : live) size += field(*s, c).size();
+        } else {
+            size = rows * (c == COL_RANK ? sizeof(int32_t) : sizeof(double));
+        }
+        directory[c] = {offset, size};
+        offset = align8(offset + size);
+    }
+
+    const string tempFile = path + ".tmp";
+    ofstream outFile(tempFile, ios::binary);
+    if (!outFile.is_open()) {
+        cerr << "Error: Could not open " << tempFile << " for writing.\n";
+        return false;
+    }
+    uint64_t written = 0;
+    auto put = [&outFile, &written](const void* data, size_t size) {
+        outFile.write(static_cast<const char*>(data), size);
+        written += size;
+    };
+    auto padTo = [&put, &written](uint64_t target) {
+        static const char zeros[8] = {};
+        put(zeros, target - written);
+    };
+
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.columnCount = SNAPSHOT_COLUMN_COUNT;
+    header.rowCount = rows;
+    put(&header, sizeof(header));
+    put(directory, sizeof(directory));
+
+    vector<uint64_t> offsets(rows + 1);
+    vector<double> doubles(rows);
+    vector<int32_t> ints(rows);
+    for (uint32_t c = 0; c < SNAPSHOT_COLUMN_COUNT; ++c) {
+        padTo(directory[c].offset);
+        if (c < SNAPSHOT_STRING_COLUMNS) {
+            offsets[0] = 0;
+            for (size_t i = 0; i < rows; ++i) offsets[i + 1] = offsets[i] + field(*live[i], c).size();
+            put(offsets.data(), offsets.size() * sizeof(uint64_t));
+            for (const Student* s : live) put(field(*s, c).data(), field(*s, c).size());
+        } else if (c == COL_RANK) {
+            for (size_t i = 0; i < rows; ++i) ints[i] = live[i]->rankObtained;
+            put(ints.data(), ints.size() * sizeof(int32_t));
+        } else {
+            for (size_t i = 0; i < rows; ++i) {
+                const Student& s = *live[i];
+                doubles[i] = (c == COL_TOTAL_MARKS) ? s.totalMarks : (c == COL_PACKAGE) ? s.expectedPackage : s.feesPaid;
+            }
+            put(doubles.data(), doubles.size() * sizeof(double));
+        }
+    }
+    outFile.close();
+    if (!outFile) {
+        cerr << "Error: Could not write " << tempFile << ".\n";
+        remove(tempFile.c_str());
+        return false;
+    }
+    return replaceFileDurably(tempFile, path);
+}
+
+// Loads students from students.shards when its manifest exists, then
+// students.snap, otherwise students.txt. Whichever was used is the format
+// compaction writes back. Shards are only listed here; see ensureAllShardsLoaded().
+void loadStudentStore() {
+    if (filesystem::exists(SHARD_DIRECTORY + "/" + SHARD_MANIFEST)) {
+        snapshotFormat = SnapshotFormat::Sharded;
+        if (readShardManifest(SHARD_DIRECTORY, studentShards)) {
+            unloadedShardCount = studentShards.size();
+            cout << "Student shard manifest loaded: " << studentShards.size() << " course(s), "
+                 << storedStudentCount() << " students (read on first use).\n";
+        }
+    } else if (filesystem::exists(SNAPSHOT_FILE)) {
+        snapshotFormat = SnapshotFormat::Binary;
+        if (readStudentSnapshot(SNAPSHOT_FILE, students)) {
+            rebuildStudentIndexes();
+            cout << "Students snapshot loaded successfully.\n";
+        }
+    } else {
+        snapshotFormat = SnapshotFormat::Csv;
+        loadStudentsFromFile();
+    }
+    loadStudentIDCounter();
+}
+
+// Writes the whole store in its current format. Background compaction passes
+// announce = false so nothing is printed over the operator's prompt.
+bool saveStudentStore(bool announce) {
+    saveStudentIDCounter();
+    if (snapshotFormat == SnapshotFormat::Csv) {
+        return announce ? saveStudentsToFile() : writeStudentsCsv(STUDENTS_FILE, students);
+    }
+    if (snapshotFormat == SnapshotFormat::Sharded) {
+        if (journalHeldBack) {
+            cerr << "Error: Not saving " << SHARD_DIRECTORY << ": " << JOURNAL_FILE << " has not been replayed.\n";
+            return false;
+        }
+        // Write from a copy so readers of the manifest never wait on the disk.
+        // Nothing else changes it meanwhile: the caller keeps records from changing.
+        vector<StudentShard> shards;
+        vector<uint8_t> changed;
+        {
+            lock_guard<mutex> metadata(shardMetadataMutex);
+            shards = studentShards;
+            changed = changedShardCourses;
+        }
+        if (!writeStudentShards(SHARD_DIRECTORY, students, shards, &changed)) return false;
+        {
+            lock_guard<mutex> metadata(shardMetadataMutex);
+            studentShards = move(shards);
+            changedShardCourses.assign(changedShardCourses.size(), 0);
+        }
+        if (announce) cout << "Student shards saved successfully.\n";
+        return true;
+    }
+    if (!writeStudentSnapshot(SNAPSHOT_FILE, students)) return false;
+    if (announce) cout << "Students snapshot saved successfully.\n";
+    return true;
+}
+
+// --- Sharded Storage ---
+// students.shards/ holds one binary snapshot per course (shard-<n>.snap, same
+// layout as students.snap) and manifest.txt with one line per shard:
+//   <file>,<rows>,<course name>
+// Only the manifest is read at startup. A course's shard is read the first
+// time a command touches just that course; the first command that needs the
+// whole store (ID lookups, listings, statistics) reads every shard still on
+// disk, one thread per shard. Saving rewrites only the shards of courses that
+// changed, then the manifest. Startup after a crash, with journal entries
+// still to replay, reads every shard (see replayStudentJournal()).
+// A shard that cannot be read stays on disk untouched: queries run without
+// its students, and changes and saves that would need it are refused.
+
+int findShard(const vector<StudentShard>& shards, string_view course) {
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (shards[i].course == course) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool readShardManifest(const string& directory, vector<StudentShard>& shards) {
+    const string path = directory + "/" + SHARD_MANIFEST;
+    ifstream in(path);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open " << path << ".\n";
+        return false;
+    }
+    shards.clear();
+    string line;
+    int lineNumber = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        size_t first = line.find(',');
+        size_t second = first == string::npos ? string::npos : line.find(',', first + 1);
+        StudentShard shard;
+        if (second == string::npos ||
+            parseNumber(string_view(line).substr(first + 1, second - first - 1), shard.rows) != FieldStatus::Ok) {
+            cerr << "Error parsing " << path << " at line " << lineNumber
+                 << ": Expected <file>,<rows>,<course>. Full line: \"" << line << "\"\n";
+            continue;
+        }
+        shard.file = line.substr(0, first);
+        shard.course = line.substr(second + 1); // Last, so course names may hold commas
+        shards.push_back(move(shard));
+    }
+    return true;
+}
+
+bool writeShardManifest(const string& directory, const vector<StudentShard>& shards) {
+    const string path = directory + "/" + SHARD_MANIFEST;
+    const string tempFile = path + ".tmp";
+    ofstream out(tempFile);
+    if (!out.is_open()) {
+        cerr << "Error: Could not open " << tempFile << " for writing.\n";
+        return false;
+    }
+    out << "# file,rows,course\n";
+    for (const auto& shard : shards) out << shard.file << ',' << shard.rows << ',' << shard.course << '\n';
+    out.close();
+    if (!out) {
+        cerr << "Error: Could not write " << tempFile << ".\n";
+        remove(tempFile.c_str());
+        return false;
+    }
+    return replaceFileDurably(tempFile, path);
+}
+
+// Reads the shards listed in `which`, one thread per shard, and appends their
+// records to out in that order. A shard that cannot be read is reported and
+// contributes nothing; shardRead, if given, gets 1 per entry of which that
+// was read and 0 per entry that was not.
+bool readStudentShards(const string& directory, const vector<StudentShard>& shards, const vector<size_t>& which,
+                       vector<Student>& out, vector<uint8_t>* shardRead) {
+    vector<vector<Student>> rows(which.size());
+    vector<StringDictionary> localCourses(which.size()), localTypes(which.size());
+    vector<string> errors(which.size());
+    auto readShard = [&](size_t i) {
+        StudentSnapshot snapshot;
+        if (!snapshot.open(directory + "/" + shards[which[i]].file, errors[i])) return;
+        rows[i].resize(snapshot.rowCount());
+        for (size_t row = 0; row < rows[i].size(); ++row) {
+            rows[i][row] = snapshot.materialize(row, localCourses[i], localTypes[i]);
+        }
+    };
+    if (which.size() == 1) {
+        readShard(0);
+    } else {
+        vector<thread> workers;
+        for (size_t i = 0; i < which.size(); ++i) workers.emplace_back(readShard, i);
+        for (auto& w : workers) w.join();
+    }
+
+    bool ok = true;
+    size_t total = out.size();
+    for (const auto& r : rows) total += r.size();
+    out.reserve(total);
+    if (shardRead) shardRead->assign(which.size(), 1);
+    for (size_t i = 0; i < which.size(); ++i) {
+        if (!errors[i].empty()) {
+            if (shardRead) (*shardRead)[i] = 0;
+            cerr << "Error: Could not load " << directory << "/" << shards[which[i]].file << ": " << errors[i] << ".\n";
+            ok = false;
+            continue;
+        }
+        adoptDictionaryIds(rows[i].data(), rows[i].data() + rows[i].size(), localCourses[i], localTypes[i]);
+        dropStudentsWithBadNumbers(rows[i], 0, directory + "/" + shards[which[i]].file);
+        if (size_t dropped = dropStudentsWithoutIds(rows[i], 0)) {
+            cerr << "Error: Skipped " << dropped << " record(s) in " << directory << "/" << shards[which[i]].file
+                 << ": too many distinct course or admission type names.\n";
+        }
+        move(rows[i].begin(), rows[i].end(), back_inserter(out));
+    }
+    return ok;
+}
+
+// Writes one shard per course from the live records, then the manifest. With
+// changedCourses, only courses flagged there are rewritten; without it, every
+// course that has students. Courses new to the manifest get a new shard file.
+bool writeStudentShards(const string& directory, const vector<Student>& records, vector<StudentShard>& shards,
+                        const vector<uint8_t>* changedCourses) {
+    error_code ec;
+    filesystem::create_directories(directory, ec);
+    if (ec) {
+        cerr << "Error: Could not create " << directory << ": " << ec.message() << "\n";
+        return false;
+    }
+    vector<vector<const Student*>> rows(courseNames.size());
+    for (const auto& s : records) {
+        if (!s.deleted) rows[s.courseId].push_back(&s);
+    }
+    // A changed course whose shard is still on disk (it could not be read)
+    // holds only some of its students in records; writing it, or a manifest
+    // counting them, would drop the rest. Write nothing and keep the journal.
+    for (uint16_t courseId = 0; changedCourses && courseId < courseNames.size(); ++courseId) {
+        int shard = findShard(shards, courseNames.name(courseId));
+        if (shard >= 0 && !shards[shard].loaded && courseId < changedCourses->size() && (*changedCourses)[courseId]) {
+            cerr << "Error: Not saving " << directory << ": the shard of " << shards[shard].course
+                 << " (" << shards[shard].file << ") could not be read.\n";
+            return false;
+        }
+    }
+    for (uint16_t courseId = 0; courseId < courseNames.size(); ++courseId) {
+        int shard = findShard(shards, courseNames.name(courseId));
+        bool changed = changedCourses ? courseId < changedCourses->size() && (*changedCourses)[courseId]
+                                      : !rows[courseId].empty();
+        if (!changed || (shard < 0 && rows[courseId].empty())) continue;
+        if (shard < 0) {
+            StudentShard added;
+            added.course = courseNames.name(courseId);
+            added.file = "shard-" + to_string(shards.size()) + ".snap";
+            added.loaded = true;
+            shards.push_back(move(added));
+            shard = static_cast<int>(shards.size() - 1);
+        }
+        if (!writeStudentSnapshotRows(directory + "/" + shards[shard].file, rows[courseId])) return false;
+        shards[shard].rows = rows[courseId].size();
+    }
+    return writeShardManifest(directory, shards);
+}
+
+// Reads the given shards of studentShards into students and indexes them.
+// A shard that cannot be read stays unloaded, so the next command that needs
+// it tries again. Returns false if any could not be read. The caller holds
+// storeMutex exclusively (or is the only thread).
+bool loadStudentShards(const vector<size_t>& which) {
+    size_t first = students.size();
+    vector<uint8_t> shardRead;
+    bool ok = readStudentShards(SHARD_DIRECTORY, studentShards, which, students, &shardRead);
+    if (first == 0) {
+        rebuildStudentIndexes();
+    } else {
+        for (size_t slot = first; slot < students.size(); ++slot) {
+            // Same warning rebuildStudentIndexes() gives for CSV and snapshot loads
+            if (findStudentSlot(students[slot].studentID) != StudentKeyIndex::NOT_FOUND) {
+                warnDuplicateStudentID(static_cast<uint32_t>(slot));
+            }
+            indexStudent(static_cast<uint32_t>(slot));
+        }
+    }
+    lock_guard<mutex> metadata(shardMetadataMutex);
+    for (size_t i = 0; i < which.size(); ++i) {
+        if (!shardRead[i]) continue;
+        studentShards[which[i]].loaded = true;
+        uint16_t courseId = courseNames.find(studentShards[which[i]].course);
+        if (courseId < changedShardCourses.size()) changedShardCourses[courseId] = 0; // Loading is not a change
+        unloadedShardCount--;
+    }
+    return ok;
+}
+
+// Reads every shard not loaded yet. Returns false if some shard could not be
+// read, or the journal was held back, leaving the store incomplete. Must not
+// be called with storeMutex held.
+bool ensureAllShardsLoaded() {
+    if (unloadedShardCount == 0) return !journalHeldBack;
+    unique_lock<shared_mutex> lock(storeMutex);
+    vector<size_t> which;
+    for (size_t i = 0; i < studentShards.size(); ++i) {
+        if (!studentShards[i].loaded) which.push_back(i);
+    }
+    return (which.empty() || loadStudentShards(which)) && !journalHeldBack;
+}
+
+// Reads one course's shard if it is not loaded yet, so the course can be
+// queried or changed without reading the rest. Returns false if it could
+// not be read or the journal was held back. Must not be called with
+// storeMutex held.
+bool ensureCourseShardLoaded(string_view course) {
+    if (unloadedShardCount == 0) return !journalHeldBack;
+    unique_lock<shared_mutex> lock(storeMutex);
+    int shard = findShard(studentShards, course);
+    return (shard < 0 || studentShards[shard].loaded || loadStudentShards({static_cast<size_t>(shard)})) &&
+           !journalHeldBack;
+}
+
+// Loads what a batch command will read or change before it takes
+// storeMutex: one course's shard for commands scoped to a course, otherwise
+// all of them. "save" only writes changed shards and needs none. Returns
+// false if a shard the command needs could not be read.
+bool loadShardsForBatchCommand(string_view command, string_view args) {
+    if (unloadedShardCount == 0 || command == "save") return true;
+    size_t in = args.find(" in ");
+    if (command == "withdraw") {
+        return ensureCourseShardLoaded(args);
+    } else if ((command == "ranks" || command == "marks") && in != string_view::npos) {
+        return ensureCourseShardLoaded(args.substr(in + 4));
+    } else if (command == "query") {
+        return loadShardsForQuery(args);
+    }
+    return ensureAllShardsLoaded();
+}
+
+// Sharded format: remembers that courseId's shard has to be rewritten
+void noteCourseChanged(uint16_t courseId) {
+    if (snapshotFormat != SnapshotFormat::Sharded) return;
+    lock_guard<mutex> metadata(shardMetadataMutex);
+    if (courseId >= changedShardCourses.size()) changedShardCourses.resize(courseId + 1);
+    changedShardCourses[courseId] = 1;
+}
+
+// Live students, counting those in shards that are still on disk
+size_t storedStudentCount() {
+    size_t count = liveStudentCount();
+    lock_guard<mutex> metadata(shardMetadataMutex);
+    for (const auto& shard : studentShards) {
+        if (!shard.loaded) count += shard.rows;
+    }
+    return count;
+}
+
+// Handles command-line invocations:
+//   --csv-to-snap [students.txt] [students.snap]
+//   --snap-to-csv [students.snap] [students.txt]
+//   --csv-to-shards [students.txt] [students.shards]
+//   --shards-to-csv [students.shards] [students.txt]
+//   --generate <count>    append synthetic students to the store (load testing)
+//   --batch [file|-]      run scripted commands without prompts (see runBatchMode)
+//   --export <file>       write the full student listing to a file
+//   --bench-stats [rows]  time the AVX2 statistics kernels against scalar code
+//   --bench-query [rows]  time the query engine over synthetic columns
+//   --bench-allot [candidates] [courses]  time a counselling round on synthetic preferences
+//   --cdc-tail <checkpoint> [--follow]  print change events after the checkpoint, then advance it
+//   --bench-dirty [rows] [bad%]  time loading a students file full of bad lines
+//   --serve <socket>      serve batch commands to many clients (see runServer)
+//   --loadgen <socket> [clients] [seconds] [write%]  measure a running server
+int runCommandLineTool(int argc, char* argv[]) {
+    string command = argv[1];
+    if (command == "--csv-to-snap" || command == "--snap-to-csv") {
+        bool toSnapshot = command == "--csv-to-snap";
+        string input = argc > 2 ? argv[2] : (toSnapshot ? STUDENTS_FILE : SNAPSHOT_FILE);
+        string output = argc > 3 ? argv[3] : (toSnapshot ? SNAPSHOT_FILE : STUDENTS_FILE);
+        vector<Student> records;
+        bool loaded = toSnapshot ? readStudentsCsv(input, records) : readStudentSnapshot(input, records);
+        if (!loaded) {
+            cerr << "Error: Could not read " << input << ".\n";
+            return 1;
+        }
+        bool saved = toSnapshot ? writeStudentSnapshot(output, records) : writeStudentsCsv(output, records);
+        if (!saved) return 1;
+        cout << "Converted " << records.size() << " students from " << input << " to " << output << ".\n";
+        return 0;
+    }
+    if (command == "--csv-to-shards" || command == "--shards-to-csv") {
+        bool toShards = command == "--csv-to-shards";
+        string input = argc > 2 ? argv[2] : (toShards ? STUDENTS_FILE : SHARD_DIRECTORY);
+        string output = argc > 3 ? argv[3] : (toShards ? SHARD_DIRECTORY : STUDENTS_FILE);
+        vector<Student> records;
+        vector<StudentShard> shards;
+        bool loaded;
+        if (toShards) {
+            loaded = readStudentsCsv(input, records);
+        } else {
+            loaded = readShardManifest(input, shards);
+            vector<size_t> which(shards.size());
+            for (size_t i = 0; i < which.size(); ++i) which[i] = i;
+            loaded = loaded && readStudentShards(input, shards, which, records);
+        }
+        if (!loaded) {
+            cerr << "Error: Could not read " << input << ".\n";
+            return 1;
+        }
+        shards.clear();
+        bool saved = toShards ? writeStudentShards(output, records, shards, nullptr) : writeStudentsCsv(output, records);
+        if (!saved) return 1;
+        cout << "Converted " << records.size() << " students from " << input << " to " << output << ".\n";
+        return 0;
+    }
+    if (command == "--generate" && argc > 2) {
+        size_t count = 0;
+        string_view text(argv[2]);
+        if (from_chars(text.data(), text.data() + text.size(), count).ec != errc() || count == 0) {
+            cerr << "Error: --generate needs a positive student count.\n";
+            return 1;
+        }
+        loadCourseCatalog();
+        loadStudentStore();
+        replayStudentJournal();
+        ensureAllShardsLoaded();
+        auto start = chrono::steady_clock::now();
+        if (!generateSampleStudents(count, cout)) return 1;
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << "Generated and saved in " << fixed << setprecision(2) << elapsed.count() << " s.\n";
+        return 0;
+    }
+    if (command == "--export" && argc > 2) {
+        loadCourseCatalog();
+        loadStudentStore();
+        replayStudentJournal();
+        auto start = chrono::steady_clock::now();
+        ensureAllShardsLoaded(); // Timed: reading the shards is part of the export
+        if (!exportStudentListing(argv[2])) return 1;
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << "Exported " << liveStudentCount() << " students to " << argv[2] << " in "
+             << fixed << setprecision(3) << elapsed.count() << " s.\n";
+        return 0;
+    }
+    if (command == "--bench-stats") {
+        size_t rows = 10000000;
+        if (argc > 2) {
+            string_view text(argv[2]);
+            if (from_chars(text.data(), text.data() + text.size(), rows).ec != errc() || rows == 0) {
+                cerr << "Error: --bench-stats needs a positive row count.\n";
+                return 1;
+            }
+        }
+        return runStatisticsBenchmark(rows);
+    }
+    if (command == "--bench-query") {
+        size_t rows = 10000000;
+        string error;
+        if (argc > 2 && (!parseNumberField(argv[2], rows, "rows", error) || rows == 0 || rows > UINT32_MAX)) {
+            cerr << "Error: --bench-query needs a positive row count.\n";
+            return 1;
+        }
+        return runQueryBenchmark(rows);
+    }
+    if (command == "--cdc-tail") {
+        bool follow = argc > 3 && string_view(argv[3]) == "--follow";
+        if (argc < 3 || (argc > 3 && !follow) || argc > 4) {
+            cerr << "Error: usage is --cdc-tail <checkpoint file> [--follow].\n";
+            return 1;
+        }
+        return runChangeTail(argv[2], follow);
+    }
+    if (command == "--bench-allot") {
+        size_t candidates = 200000;
+        size_t courseCount = 50;
+        string error;
+        if ((argc > 2 && (!parseNumberField(argv[2], candidates, "candidates", error) || candidates == 0 ||
+                          candidates > INT32_MAX)) ||
+            (argc > 3 && (!parseNumberField(argv[3], courseCount, "courses", error) || courseCount == 0 ||
+                          courseCount > 1000))) {
+            cerr << "Error: usage is --bench-allot [candidates] [courses 1-1000].\n";
+            return 1;
+        }
+        return runCounsellingBenchmark(candidates, courseCount);
+    }
+    if (command == "--bench-dirty") {
+        size_t rows = 1000000;
+        unsigned badPercent = 50;
+        string error;
+        if ((argc > 2 && (!parseNumberField(argv[2], rows, "rows", error) || rows == 0)) ||
+            (argc > 3 && (!parseNumberField(argv[3], badPercent, "bad%", error) || badPercent > 100))) {
+            cerr << "Error: usage is --bench-dirty [rows] [bad% 0-100].\n";
+            return 1;
+        }
+        return runDirtyParseBenchmark(rows, badPercent);
+    }
+    if (command == "--serve" && argc > 2) {
+        loadCourseCatalog();
+        loadStudentStore();
+        replayStudentJournal();
+        return runServer(argv[2]);
+    }
+    if (command == "--loadgen" && argc > 2) {
+        size_t clientCount = 8;
+        double seconds = 10;
+        unsigned writePercent = 10;
+        string error;
+        if ((argc > 3 && !parseNumberField(argv[3], clientCount, "clients", error)) ||
+            (argc > 4 && !parseNumberField(argv[4], seconds, "seconds", error)) ||
+            (argc > 5 && !parseNumberField(argv[5], writePercent, "write%", error)) ||
+            clientCount == 0 || seconds <= 0 || writePercent > 100) {
+            cerr << "Error: usage is --loadgen <socket> [clients] [seconds] [write% 0-100].\n";
+            return 1;
+        }
+        return runLoadGenerator(argv[2], clientCount, seconds, writePercent);
+    }
+    if (command == "--batch") {
+        string source = argc > 2 ? argv[2] : "-";
+        ifstream file;
+        if (source != "-") {
+            file.open(source);
+            if (!file.is_open()) {
+                cerr << "Error: Could not open batch file " << source << ".\n";
+                return 1;
+            }
+        }
+        loadCourseCatalog();
+        loadStudentStore();
+        replayStudentJournal();
+        return runBatchMode(source == "-" ? cin : file);
+    }
+    cerr << "Unknown option: " << command << "\n";
+    cerr << "Usage: " << argv[0] << " [--csv-to-snap [in] [out] | --snap-to-csv [in] [out] | --csv-to-shards [in] [out] | --shards-to-csv [in] [out] | --generate <count> | --batch [file|-] | --export <file> | --bench-stats [rows] | --bench-query [rows] | --bench-allot [candidates] [courses] | --cdc-tail <checkpoint> [--follow] | --bench-dirty [rows] [bad%] | --serve <socket> | --loadgen <socket> [clients] [seconds] [write%]]\n";
+    return 1;
+}
+
+// Parses a students.txt style file into out, reporting bad lines on cerr.
+// Returns false only if the file could not be opened.
+bool readStudentsCsv(const string& path, vector<Student>& out) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    out.clear();
+
+    const char* begin = file.data();
+    const char* end = file.data() + file.size();
+
+    // Split the mapping into one slice per core, each ending on a record
+    // boundary. A newline only ends a record outside quotes, and whether a
+    // quote opens a field depends on the state before it, so every slice is
+    // scanned (in parallel) from each possible starting state. Chaining the
+    // results from the start of the file gives the state at each split point.
+    size_t threadCount = max(1u, thread::hardware_concurrency());
+    threadCount = max<size_t>(1, min(threadCount, file.size() / MIN_PARSE_CHUNK_BYTES));
+    vector<const char*> targets;
+    for (size_t i = 0; i <= threadCount; ++i) targets.push_back(begin + file.size() * i / threadCount);
+    const int stateCount = 3;
+    vector<array<CsvQuoteState, stateCount>> endStates(threadCount); // Indexed by the state the slice starts in
+    if (threadCount > 1) {
+        vector<thread> scanners;
+        for (size_t i = 0; i < threadCount; ++i) {
+            scanners.emplace_back([&targets, &endStates, begin, i] {
+                for (int s = 0; s < stateCount; ++s) {
+                    endStates[i][s] = advanceCsvQuoteState(targets[i], targets[i + 1], begin, static_cast<CsvQuoteState>(s));
+                }
+            });
+        }
+        for (auto& s : scanners) s.join();
+    }
+    vector<const char*> bounds{begin};
+    CsvQuoteState state = CsvQuoteState::Outside;
+    for (size_t i = 1; i < threadCount; ++i) {
+        state = endStates[i - 1][static_cast<int>(state)];
+        const char* from = targets[i];
+        CsvQuoteState fromState = state;
+        if (from < bounds.back()) { // A long quoted record already carried the previous split past here
+            from = bounds.back();
+            fromState = CsvQuoteState::Outside;
+        }
+        const char* start = nextCsvRecordStart(from, end, begin, fromState);
+        if (start >= end) break;
+        if (start > bounds.back()) bounds.push_back(start);
+    }
+    bounds.push_back(end);
+
+    vector<StudentChunkResult> results(bounds.size() - 1);
+    if (results.size() == 1) {
+        parseStudentChunk(begin, end, results[0]);
+    } else {
+        vector<thread> workers;
+        for (size_t i = 0; i < results.size(); ++i) {
+            workers.emplace_back(parseStudentChunk, bounds[i], bounds[i + 1], ref(results[i]));
+        }
+        for (auto& w : workers) w.join();
+    }
+
+    // Merge in file order so the in-memory order matches students.txt
+    size_t total = 0;
+    for (const auto& r : results) total += r.students.size();
+    out.reserve(total);
+    ParseErrorReport errors;
+    size_t lineBase = 0;
+    for (auto& r : results) {
+        errors.merge(r.errors, lineBase);
+        adoptDictionaryIds(r.students.data(), r.students.data() + r.students.size(), r.courseNames, r.admissionTypes);
+        move(r.students.begin(), r.students.end(), back_inserter(out));
+        lineBase += r.lineCount;
+    }
+    errors.print(cerr, path, STUDENT_FIELD_NAMES);
+    // Each worker reported its own overflowing rows; these only overflowed
+    // once the workers' names were combined
+    if (size_t dropped = dropStudentsWithoutIds(out, 0)) {
+        cerr << "Error: Skipped " << dropped << " more record(s) in " << path << ": too many distinct course or admission type names.\n";
+    }
+    return true;
+}
+
+// Writes a students file where badPercent of the lines are broken in one of
+// several ways, then times loading it
+int runDirtyParseBenchmark(size_t rows, unsigned badPercent) {
+    static const char* const breakages[] = {
+        "not-a-number", "1e999999", "", "12.5.7", "abc123"};
+    const string path = "bench_dirty_students.txt";
+    {
+        ofstream out(path);
+        if (!out.is_open()) {
+            cerr << "Error: Could not open " << path << " for writing.\n";
+            return 1;
+        }
+        FastRandom rng(777);
+        string line;
+        for (size_t i = 0; i < rows; ++i) {
+            string marks = to_string(300 + rng.below(200)) + ".25";
+            string rank = to_string(1 + rng.below(5000));
+            bool bad = rng.below(100) < badPercent;
+            if (bad) {
+                uint64_t how = rng.below(6);
+                if (how == 5) { // Truncated line, fields missing
+                    out << "Student " << i << ",9800000000,student" << i << "@example.com\n";
+                    continue;
+                }
+                (rng.below(2) ? marks : rank) = breakages[how];
+            }
+            out << "Student " << i << ",9800000000,student" << i << "@example.com,Street " << i % 100
+                << " City " << i % 10 << ",O+,SID" << FIRST_STUDENT_NUMBER + i << ",Civil Engineering,KCET,"
+                << marks << "," << rank << ",6.50,90000.00\n";
+        }
+    }
+
+    vector<Student> records;
+    auto start = chrono::steady_clock::now();
+    bool ok = readStudentsCsv(path, records);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    remove(path.c_str());
+    if (!ok) return 1;
+    cout << "Loaded " << records.size() << " of " << rows << " lines (" << badPercent << "% broken) in "
+         << fixed << setprecision(3) << elapsed.count() << " s, "
+         << setprecision(0) << rows / elapsed.count() << " lines/sec\n";
+    return 0;
+}
+
+// Function to load students data from file with error handling
+void loadStudentsFromFile() {
+    if (!readStudentsCsv(STUDENTS_FILE, students)) {
+        cerr << "Warning: Students file not found or could not be opened. Starting with empty data.\n";
+        return;
+    }
+    rebuildStudentIndexes();
+    cout << "Students data loaded (or attempted to load) successfully.\n";
+}
+
+// Function to save course data to file
+void saveCoursesToFile() {
+    ofstream outFile(COURSES_FILE);
+    if (!outFile.is_open()) {
+        cerr << "Error: Could not open courses file for writing.\n";
+        return;
+    }
+    for (const auto& c : courses) {
+        outFile << c.courseName << ","
+                << fixed << setprecision(2) << c.kcetFees << ","
+                << fixed << setprecision(2) << c.managementFees << "\n";
+    }
+    outFile.close();
+    cout << "Courses data saved successfully.\n";
+}
+
+// Parses one courses.txt line: name, KCET fees, management fees (the last
+// field runs to the end of the line)
+bool parseCourseRow(string_view line, Course& c, RowError& error) {
+    size_t first = line.find(',');
+    if (line.empty() || first == string_view::npos) {
+        error = {line.empty() ? 0 : 1, FieldStatus::Missing};
+        return false;
+    }
+    size_t second = line.find(',', first + 1);
+    if (second == string_view::npos) {
+        error = {2, FieldStatus::Missing};
+        return false;
+    }
+    FieldStatus status;
+    if ((status = parseNumber(line.substr(first + 1, second - first - 1), c.kcetFees)) != FieldStatus::Ok) {
+        error = {1, status};
+        return false;
+    }
+    if ((status = parseNumber(line.substr(second + 1), c.managementFees)) != FieldStatus::Ok) {
+        error = {2, status};
+        return false;
+    }
+    c.courseName.assign(line.substr(0, first));
+    return true;
+}
+
+// Function to load course data from file with error handling
+void loadCoursesFromFile() {
+    MappedFile file;
+    if (!file.open(COURSES_FILE)) {
+        cerr << "Warning: Courses file not found or could not be opened. Starting with empty course data.\n";
+        return;
+    }
+    courses.clear(); // Clear existing data
+
+    ParseErrorReport errors;
+    RowError error;
+    LineReader lines(file);
+    string_view line;
+    while (lines.next(line)) {
+        Course c;
+        if (parseCourseRow(line, c, error)) {
+            courses.push_back(move(c));
+        } else {
+            errors.add(error, lines.lineNumber(), line);
+        }
+    }
+    errors.print(cerr, COURSES_FILE, COURSE_FIELD_NAMES);
+    cout << "Courses data loaded (or attempted to load) successfully.\n";
+}
+
+// Loads courses.txt, falling back to (and saving) the default courses
+void loadCourseCatalog() {
+    loadCoursesFromFile();
+    // If courses file was empty or not found, initialize some default courses
+    if (courses.empty()) {
+        cout << "No course data found. Initializing default courses.\n";
+        initializeDefaultCourses();
+        saveCoursesToFile(); // Save default courses
+    }
+    indexCourses();
+}
+
+// Interns every offered course and maps its ID back to its slot in courses
+void indexCourses() {
+    for (const auto& c : courses) courseNames.intern(c.courseName);
+    courseSlotById.assign(courseNames.size(), -1);
+    for (size_t i = 0; i < courses.size(); ++i) {
+        uint16_t courseId = courseNames.find(courses[i].courseName);
+        if (courseId != StringDictionary::NOT_FOUND) courseSlotById[courseId] = static_cast<int>(i);
+    }
+}
+
+// Function to add default engineering courses
+void initializeDefaultCourses() {
+    courses.push_back({"Computer Science Engineering", 150000.0, 250000.0});
+    courses.push_back({"Electronics & Communication Engineering", 120000.0, 200000.0});
+    courses.push_back({"Mechanical Engineering", 100000.0, 180000.0});
+    courses.push_back({"Civil Engineering", 90000.0, 160000.0});
+    cout << "Default courses initialized.\n";
+}
+
+// Returns the offered course with this ID, or nullptr
+const Course* findCourse(uint16_t courseId) {
+    if (courseId >= courseSlotById.size() || courseSlotById[courseId] < 0) return nullptr;
+    return &courses[courseSlotById[courseId]];
+}
+
+// Fees for a course; management admissions get the management discount.
+// Other admission types have no fees (NaN): callers must reject them first.
+double calculateFees(const Course& course, uint16_t admissionTypeId) {
+    if (admissionTypeId == ADMISSION_KCET) {
+        return course.kcetFees;
+    }
+    if (admissionTypeId == ADMISSION_MANAGEMENT) {
+        return course.managementFees * (1 - MANAGEMENT_DISCOUNT_PERCENTAGE / 100.0);
+    }
+    return numeric_limits<double>::quiet_NaN();
+}
+
+
+// Function to generate a unique student ID. Fails once the student number
+// space is used up.
+bool generateStudentID(string& id) {
+    if (nextStudentNumber == UINT32_MAX) {
+        cerr << "Error: No student IDs are left below SID" << UINT32_MAX << ".\n";
+        return false;
+    }
+    id = "SID" + to_string(nextStudentNumber++);
+    return true;
+}
+
+// Raises the ID high-water mark past an existing "SID<number>" ID. Called for
+// every record that enters the store, so generateStudentID() never rescans.
+// The mark saturates at UINT32_MAX, which marks the space as used up and is
+// never handed out itself.
+void noteStudentID(string_view id) {
+    if (id.size() <= 3 || id.substr(0, 3) != "SID") return;
+    uint32_t number;
+    auto result = from_chars(id.data() + 3, id.data() + id.size(), number);
+    if (result.ec == errc() && result.ptr == id.data() + id.size() && number >= nextStudentNumber) {
+        nextStudentNumber = number == UINT32_MAX ? UINT32_MAX : number + 1;
+    }
+}
+
+// Function to load the persisted ID high-water mark. Never lowers the mark
+// already derived from the loaded records.
+void loadStudentIDCounter() {
+    ifstream inFile(ID_COUNTER_FILE);
+    uint32_t stored;
+    if (inFile >> stored && stored > nextStudentNumber) {
+        nextStudentNumber = stored;
+    }
+}
+
+// Written to a temporary file and renamed over the old one, so a crash can
+// never leave a truncated counter that would hand out used IDs again
+bool saveStudentIDCounter() {
+    string tempFile = ID_COUNTER_FILE + ".tmp";
+    ofstream outFile(tempFile);
+    if (!outFile.is_open()) {
+        cerr << "Error: Could not open " << tempFile << " for writing.\n";
+        return false;
+    }
+    outFile << nextStudentNumber << "\n";
+    outFile.close();
+    if (!outFile) {
+        cerr << "Error: Could not write " << tempFile << ".\n";
+        remove(tempFile.c_str());
+        return false;
+    }
+    return replaceFileDurably(tempFile, ID_COUNTER_FILE);
+}
+
+// Function to add a new student
+void addStudent() {
+    // Phone numbers and emails must be unique across every course
+    if (!ensureAllShardsLoaded()) {
+        cout << "Cannot add students while a student shard cannot be read.\n";
+        return;
+    }
+    Student s;
+    cout << "\n--- Add New Student ---\n";
+
+    {
+        unique_lock<shared_mutex> lock(storeMutex); // The journal writer may be saving the ID counter
+        if (!generateStudentID(s.studentID)) return; // Assign unique ID
+    }
+
+    cout << "Enter student name: ";
+    getline(cin, s.name);
+    cout << "Enter phone number: ";
+    readUniqueContact(s.phoneNumber, phoneIndex, "phone number", StudentKeyIndex::NOT_FOUND);
+    cout << "Enter email: ";
+    readUniqueContact(s.email, emailIndex, "email", StudentKeyIndex::NOT_FOUND);
+    cout << "Enter address: ";
+    getline(cin, s.address);
+    cout << "Enter blood group: ";
+    getline(cin, s.bloodGroup);
+
+    // Course selection
+    if (courses.empty()) {
+        cout << "No courses available. Please add courses by modifying 'courses.txt' or ensure it's not empty.\n";
+        return;
+    }
+    displayCourseDetails();
+    cout << "Enter the exact course name for admission: ";
+    string courseInput;
+    getline(cin, courseInput);
+    s.courseId = courseNames.find(courseInput);
+    const Course* selectedCourse = findCourse(s.courseId);
+    if (selectedCourse == nullptr) {
+        cout << "Error: Course not found. Please enter an exact course name from the list.\n";
+        return;
+    }
+
+    cout << "Enter admission type (KCET/Management): ";
+    string typeInput;
+    getline(cin, typeInput);
+    while (typeInput != "KCET" && typeInput != "Management") {
+        cout << "Invalid admission type. Please enter 'KCET' or 'Management': ";
+        getline(cin, typeInput);
+    }
+    s.admissionTypeId = admissionTypes.find(typeInput);
+
+    s.feesPaid = calculateFees(*selectedCourse, s.admissionTypeId);
+    cout << "Calculated Fees: " << fixed << setprecision(2) << s.feesPaid << " INR\n";
+
+    cout << "Enter total marks obtained (out of 500): ";
+    while (!(cin >> s.totalMarks) || s.totalMarks < 0 || s.totalMarks > 500) {
+        cout << "Invalid marks. Please enter a number between 0 and 500: ";
+        cin.clear();
+        clearInputBuffer();
+    }
+    cout << "Enter rank obtained: ";
+    while (!(cin >> s.rankObtained) || s.rankObtained <= 0) {
+        cout << "Invalid rank. Please enter a positive integer: ";
+        cin.clear();
+        clearInputBuffer();
+    }
+    cout << "Enter expected package after graduation (in Lakhs per annum): ";
+    while (!(cin >> s.expectedPackage) || s.expectedPackage < 0) {
+        cout << "Invalid package. Please enter a non-negative number: ";
+        cin.clear();
+        clearInputBuffer();
+    }
+    clearInputBuffer(); // Clear buffer after numeric input
+
+    {
+        unique_lock<shared_mutex> lock(storeMutex);
+        insertStudentRecord(s);
+        journalStudentWrite('A', s);
+    }
+    cout << "Student record added successfully with ID: " << s.studentID << "!\n";
+}
+
+// Function to display all students
+void displayAllStudents() {
+    ensureAllShardsLoaded();
+    if (liveStudentCount() == 0) {
+        cout << "\nNo student records to display.\n";
+        return;
+    }
+    size_t pageSize;
+    cout << "Enter page size (0 to show all): ";
+    while (!(cin >> pageSize)) {
+        cout << "Invalid page size. Please enter a non-negative integer: ";
+        cin.clear();
+        clearInputBuffer();
+    }
+    clearInputBuffer(); // Clear buffer after numeric input
+    size_t total = liveStudentCount();
+    if (pageSize == 0) pageSize = total;
+
+    OutputBuffer out(cout);
+    out << "\n---- All Student Records ------\n";
+    size_t cursor = 0;
+    for (size_t shown = 0; shown < total;) {
+        shown += renderStudentList(out, cursor, pageSize);
+        out << "--------------------------------\n";
+        if (shown >= total) break;
+        out << "Showing " << shown << " of " << total << ". Show next page? (y/n): ";
+        out.flush();
+        cout.flush(); // The prompt has to be visible before we wait for input
+        string answer;
+        getline(cin, answer);
+        if (answer != "y" && answer != "Y") break;
+    }
+}
+
+// Renders up to count records starting at slot cursor, skipping tombstones.
+// Returns how many were rendered and leaves cursor on the next slot to read.
+size_t renderStudentList(OutputBuffer& out, size_t& cursor, size_t count) {
+    size_t shown = 0;
+    for (; cursor < students.size() && shown < count; ++cursor) {
+        if (students[cursor].deleted) continue;
+        out << "--------------------------------\n";
+        renderStudentDetails(out, students[cursor]);
+        shown++;
+    }
+    return shown;
+}
+
+// Writes the full listing to a file in large unflushed chunks. The caller
+// holds storeMutex, shared or exclusive; writers of the file take exportFileMutex.
+bool exportStudentListing(const string& path) {
+    lock_guard<mutex> writing(exportFileMutex);
+    ofstream file(path, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open " << path << " for writing.\n";
+        return false;
+    }
+    {
+        OutputBuffer out(file, 8 << 20);
+        size_t cursor = 0;
+        renderStudentList(out, cursor, SIZE_MAX);
+    }
+    file.close();
+    return static_cast<bool>(file);
+}
+
+// Function to search student by ID
+void searchStudentByID() {
+    ensureAllShardsLoaded();
+    if (liveStudentCount() == 0) {
+        cout << "No students to search.\n";
+        return;
+    }
+    string idToSearch;
+    cout << "Enter student ID to search (e.g., SID1001): ";
+    getline(cin, idToSearch);
+
+    uint32_t slot = findStudentSlot(idToSearch);
+    if (slot == StudentKeyIndex::NOT_FOUND) {
+        cout << "Student with ID " << idToSearch << " not found.\n";
+        return;
+    }
+    OutputBuffer out(cout, 1024);
+    out << "\n--- Student Found ---\n";
+    renderStudentDetails(out, students[slot]);
+}
+
+// Function to look students up by part of their name or email
+void searchStudentsByText() {
+    ensureAllShardsLoaded();
+    if (liveStudentCount() == 0) {
+        cout << "No students to search.\n";
+        return;
+    }
+    string query;
+    cout << "Enter the start of a name, or any part of a name or email: ";
+    getline(cin, query);
+
+    OutputBuffer out(cout);
+    size_t found = textIndex.search(query, SEARCH_RESULT_LIMIT, [&out](uint32_t slot) {
+        const Student& s = students[slot];
+        out << s.studentID << "  " << s.name << "  <" << s.email << ">\n";
+    });
+    if (found == 0) {
+        out << "No students match '" << query << "'.\n";
+    } else if (found == SEARCH_RESULT_LIMIT) {
+        out << "(Showing the first " << SEARCH_RESULT_LIMIT << " matches; type more to narrow the search.)\n";
+    }
+}
+
+// Prints every field of one student, one per line
+void printStudentDetails(ostream& out, const Student& s) {
+    OutputBuffer buffer(out, 1024);
+    renderStudentDetails(buffer, s);
+}
+
+void renderStudentDetails(OutputBuffer& out, const Student& s) {
+    out << "Student ID: " << s.studentID << '\n';
+    out << "Name: " << s.name << '\n';
+    out << "Phone: " << s.phoneNumber << '\n';
+    out << "Email: " << s.email << '\n';
+    out << "Address: " << s.address << '\n';
+    out << "Blood Group: " << s.bloodGroup << '\n';
+    out << "Course: " << courseName(s) << '\n';
+    out << "Admission Type: " << admissionTypeName(s) << '\n';
+    out << "Total Marks: ";
+    out.fixed(s.totalMarks) << '\n';
+    out << "Rank: " << s.rankObtained << '\n';
+    out << "Expected Package: ";
+    out.fixed(s.expectedPackage) << " LPA\n";
+    out << "Fees Paid: ";
+    out.fixed(s.feesPaid) << " INR\n";
+}
+
+// Function to update student details (by ID)
+void updateStudentDetails() {
+    if (!ensureAllShardsLoaded()) {
+        cout << "Cannot update students while a student shard cannot be read.\n";
+        return;
+    }
+    if (liveStudentCount() == 0) {
+        cout << "No students to update.\n";
+        return;
+    }
+    string idToUpdate;
+    cout << "Enter student ID to update: ";
+    getline(cin, idToUpdate);
+
+    uint32_t slot = findStudentSlot(idToUpdate);
+    if (slot == StudentKeyIndex::NOT_FOUND) {
+        cout << "Student with ID " << idToUpdate << " not found.\n";
+        return;
+    }
+    Student s = students[slot]; // Edit a copy so the indexes can still see the old values
+    cout << "\n--- Updating Student (ID: " << s.studentID << ") ---\n";
+    cout << "Enter new name (current: " << s.name << "): ";
+    getline(cin, s.name);
+    cout << "Enter new phone number (current: " << s.phoneNumber << "): ";
+    readUniqueContact(s.phoneNumber, phoneIndex, "phone number", slot);
+    cout << "Enter new email (current: " << s.email << "): ";
+    readUniqueContact(s.email, emailIndex, "email", slot);
+    cout << "Enter new address (current: " << s.address << "): ";
+    getline(cin, s.address);
+    cout << "Enter new blood group (current: " << s.bloodGroup << "): ";
+    getline(cin, s.bloodGroup);
+
+    // Re-select course and admission type to update fees if needed
+    if (courses.empty()) {
+        cout << "No courses available to choose from. Course will remain: " << courseName(s) << endl;
+    } else {
+        displayCourseDetails();
+        cout << "Enter new course for admission (current: " << courseName(s) << "): ";
+        string newCourseName;
+        getline(cin, newCourseName);
+        uint16_t newCourseId = courseNames.find(newCourseName);
+        const Course* newSelectedCourse = findCourse(newCourseId);
+        if (newSelectedCourse == nullptr) {
+            cout << "Error: New course not found. Keeping old course: " << courseName(s) << endl;
+        } else {
+            s.courseId = newCourseId;
+            cout << "Enter new admission type (KCET/Management) (current: " << admissionTypeName(s) << "): ";
+            string typeInput;
+            getline(cin, typeInput);
+            while (typeInput != "KCET" && typeInput != "Management") {
+                cout << "Invalid admission type. Please enter 'KCET' or 'Management': ";
+                getline(cin, typeInput);
+            }
+            s.admissionTypeId = admissionTypes.find(typeInput);
+
+            s.feesPaid = calculateFees(*newSelectedCourse, s.admissionTypeId);
+            cout << "New Fees calculated: " << fixed << setprecision(2) << s.feesPaid << " INR\n";
+        }
+    }
+
+    cout << "Enter new total marks (current: " << fixed << setprecision(2) << s.totalMarks << "): ";
     while (!(cin >> s.totalMarks) || s.totalMarks < 0 || s.totalMarks > 500) {
         cout << "Invalid marks. Please enter a number between 0 and 500: ";
         cin.clear();
         clearInputBuffer();
     }
-    cout << "Enter rank obtained: ";
-    while (!(cin >> s.rankObtained) || s.rankObtained <= 0) {
-        cout << "Invalid rank. Please enter a positive integer: ";
+    cout << "Enter new rank (current: " << s.rankObtained << "): ";
+    while (!(cin >> s.rankObtained) || s.rankObtained <= 0) {
+        cout << "Invalid rank. Please enter a positive integer: ";
+        cin.clear();
+        clearInputBuffer();
+    }
+    cout << "Enter new expected package (current: " << fixed << setprecision(2) << s.expectedPackage << "): ";
+    while (!(cin >> s.expectedPackage) || s.expectedPackage < 0) {
+        cout << "Invalid package. Please enter a non-negative number: ";
+        cin.clear();
+        clearInputBuffer();
+    }
+    clearInputBuffer(); // Clear buffer after numeric input
+
+    {
+        unique_lock<shared_mutex> lock(storeMutex);
+        replaceStudentRecord(slot, move(s));
+        journalStudentWrite('U', students[slot]);
+    }
+    cout << "Student details updated successfully!\n";
+}
+
+// Function to delete student by ID
+void deleteStudentByID() {
+    if (!ensureAllShardsLoaded()) {
+        cout << "Cannot delete students while a student shard cannot be read.\n";
+        return;
+    }
+    if (liveStudentCount() == 0) {
+        cout << "No students to delete.\n";
+        return;
+    }
+    string idToDelete;
+    cout << "Enter student ID to delete: ";
+    getline(cin, idToDelete);
+
+    unique_lock<shared_mutex> lock(storeMutex);
+    if (removeStudentRecord(idToDelete)) {
+        journalStudentDelete(idToDelete);
+        compactStudentSlotsIfDue();
+        lock.unlock();
+        cout << "Student with ID " << idToDelete << " deleted successfully.\n";
+    } else {
+        cout << "Student with ID " << idToDelete << " not found.\n";
+    }
+}
+
+// Function to delete every student admitted to one course, e.g. when the
+// course is discontinued. Journaled as a single entry.
+void withdrawCourse() {
+    if (storedStudentCount() == 0) {
+        cout << "No students to withdraw.\n";
+        return;
+    }
+    string courseInput;
+    cout << "Enter course name to withdraw all its students from: ";
+    getline(cin, courseInput);
+    if (!ensureCourseShardLoaded(courseInput)) {
+        cout << "Cannot withdraw '" << courseInput << "' while its student shard cannot be read.\n";
+        return;
+    }
+    uint16_t courseId = courseNames.find(courseInput);
+    if (courseId == StringDictionary::NOT_FOUND || admissionAggregates.byCourse(courseId).count == 0) {
+        cout << "No students have been admitted to '" << courseInput << "'.\n";
+        return;
+    }
+    cout << "Delete all " << admissionAggregates.byCourse(courseId).count << " students of '" << courseInput
+         << "'? (y/n): ";
+    string answer;
+    getline(cin, answer);
+    if (answer != "y" && answer != "Y") {
+        cout << "Nothing was deleted.\n";
+        return;
+    }
+
+    unique_lock<shared_mutex> lock(storeMutex);
+    vector<string> withdrawnIds;
+    size_t withdrawn = withdrawCourseStudents(courseId, &withdrawnIds);
+    journalCourseWithdrawal(courseInput, withdrawnIds);
+    lock.unlock();
+    cout << withdrawn << " student(s) withdrawn from '" << courseInput << "'.\n";
+}
+
+// Function to list students by rank, a page at a time, straight from the rank
+// index. Nothing is re-sorted and only the rows shown are read.
+void sortStudentsByRank() {
+    ensureAllShardsLoaded();
+    if (liveStudentCount() == 0) {
+        cout << "No students to sort.\n";
+        return;
+    }
+    int fromRank;
+    cout << "Enter starting rank (1 for the top): ";
+    while (!(cin >> fromRank)) {
+        cout << "Invalid rank. Please enter an integer: ";
+        cin.clear();
+        clearInputBuffer();
+    }
+    size_t pageSize;
+    cout << "Enter page size: ";
+    while (!(cin >> pageSize) || pageSize == 0) {
+        cout << "Invalid page size. Please enter a positive integer: ";
+        cin.clear();
+        clearInputBuffer();
+    }
+    clearInputBuffer(); // Clear buffer after numeric input
+
+    RankPageCursor cursor;
+    string answer = "y";
+    while (answer == "y" || answer == "Y") {
+        OutputBuffer out(cout);
+        out << "\n---- Students by Rank ------\n";
+        size_t shown = visitStudentsByRank(fromRank, INT32_MAX, ANY_COURSE, pageSize, cursor, [&out](const Student& s) {
+            out << "--------------------------------\n";
+            renderStudentDetails(out, s);
+        });
+        out << "--------------------------------\n";
+        out.flush();
+        if (shown < pageSize) {
+            cout << "End of list.\n";
+            break;
+        }
+        cout << "Show next page? (y/n): ";
+        getline(cin, answer);
+    }
+}
+
+// Function to list students whose marks or rank fall in a range, optionally
+// in one course, straight from the marks and rank indexes
+void searchStudentsByRange() {
+    if (storedStudentCount() == 0) {
+        cout << "No students to search.\n";
+        return;
+    }
+    string byInput;
+    cout << "Search by (M)arks or (R)ank: ";
+    getline(cin, byInput);
+    bool byMarks = byInput == "M" || byInput == "m";
+    if (!byMarks && byInput != "R" && byInput != "r") {
+        cout << "Invalid choice. Please enter M or R.\n";
+        return;
+    }
+    double low, high;
+    cout << (byMarks ? "Enter lowest marks: " : "Enter lowest rank: ");
+    while (!(cin >> low)) {
+        cout << "Invalid number. Please enter a number: ";
+        cin.clear();
+        clearInputBuffer();
+    }
+    cout << (byMarks ? "Enter highest marks: " : "Enter highest rank: ");
+    while (!(cin >> high) || high < low) {
+        cout << "Invalid number. Please enter a number not below " << low << ": ";
         cin.clear();
         clearInputBuffer();
     }
-    cout << "Enter expected package after graduation (in Lakhs per annum): ";
-    while (!(cin >> s.expectedPackage) || s.expectedPackage < 0) {
-        cout << "Invalid package. Please enter a non-negative number: ";
-        cin.clear();
-        clearInputBuffer();
+    clearInputBuffer(); // Clear buffer after numeric input
+
+    string courseInput;
+    cout << "Enter course name (leave blank for all courses): ";
+    getline(cin, courseInput);
+    if (courseInput.empty()) {
+        ensureAllShardsLoaded();
+    } else {
+        ensureCourseShardLoaded(courseInput);
+    }
+    uint16_t courseId = ANY_COURSE;
+    if (!courseInput.empty()) {
+        courseId = courseNames.find(courseInput);
+        if (courseId == StringDictionary::NOT_FOUND) {
+            cout << "No students have been admitted to '" << courseInput << "'.\n";
+            return;
+        }
+    }
+
+    OutputBuffer out(cout);
+    out << "\n---- Students with " << (byMarks ? "marks" : "rank") << " in range ------\n";
+    auto render = [&out](const Student& s) {
+        out << "--------------------------------\n";
+        renderStudentDetails(out, s);
+    };
+    RankPageCursor cursor;
+    size_t shown = byMarks ? visitStudentsByMarks(low, high, courseId, SIZE_MAX, render)
+                           : visitStudentsByRank(static_cast<int>(max(low, double(INT32_MIN))),
+                                                 static_cast<int>(min(high, double(INT32_MAX))),
+                                                 courseId, SIZE_MAX, cursor, render);
+    out << "--------------------------------\n";
+    out << shown << " student(s) found.\n";
+}
+
+// Function to generate sample students. Rows are filled on one thread per
+// core, each with its own random stream; a batch at least as large as the
+// store is then indexed in one bulk rebuild rather than row by row.
+// Fails if the new IDs would not fit in the student number space. Results
+// and errors go to out, the server's client included.
+bool generateSampleStudents(size_t count, ostream& out) {
+    if (courses.empty()) {
+        out << "Cannot generate sample students, no courses defined. Please ensure 'courses.txt' has data or default courses are initialized.\n";
+        return false;
+    }
+    if (count > UINT32_MAX - nextStudentNumber) {
+        out << "Error: Cannot generate " << count << " students, only " << UINT32_MAX - nextStudentNumber
+             << " student IDs are left after SID" << nextStudentNumber << ".\n";
+        return false;
+    }
+    static const string names[] = {"Alice", "Bob", "Charlie", "Diana", "Eve", "Frank", "Grace", "Heidi", "Ivan", "Judy",
+                                   "Kevin", "Liam", "Mia", "Noah", "Olivia", "Peter", "Quinn", "Rachel", "Sam", "Tina",
+                                   "Uma", "Victor", "Wendy", "Xavier", "Yara", "Zack", "Anna", "Ben", "Chloe", "David",
+                                   "Emily", "Fred", "Gina", "Harry", "Iris", "Jack", "Karen", "Leo", "Mona", "Nate"}; // More names
+    static const string bloodGroups[] = {"A+", "B+", "AB+", "O+", "A-", "B-", "AB-", "O-"};
+    const uint32_t nameCount = sizeof(names) / sizeof(names[0]);
+    const uint32_t bloodGroupCount = sizeof(bloodGroups) / sizeof(bloodGroups[0]);
+
+    // Reserve a contiguous block of IDs up front so workers never contend on the counter
+    const uint32_t firstNumber = nextStudentNumber;
+    nextStudentNumber += static_cast<uint32_t>(count);
+    const uint64_t seed = (static_cast<uint64_t>(random_device()()) << 32) ^
+                          static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+
+    // Look course IDs up once; workers must not touch the shared dictionary
+    vector<uint16_t> courseIds;
+    for (const auto& c : courses) courseIds.push_back(courseNames.intern(c.courseName));
+
+    vector<Student> batch(count);
+    auto fillRows = [&](size_t first, size_t last, uint64_t threadSeed) {
+        FastRandom rng(threadSeed);
+        for (size_t i = first; i < last; ++i) {
+            Student& s = batch[i];
+            s.studentID = "SID" + to_string(firstNumber + i);
+            const string& firstName = names[i % nameCount];
+            s.name = firstName + " " + to_string(100 + rng.below(900)); // Add random number for more unique names
+            // Contacts are derived from the student number so they never collide:
+            // multiplying by 3^18 permutes 0..10^9-1, scattering the phone numbers
+            uint32_t number = firstNumber + static_cast<uint32_t>(i);
+            s.phoneNumber = to_string(9000000000ULL + number * 387420489ULL % 1000000000ULL); // Dummy number
+            s.email = firstName + "." + to_string(number) + "@example.com";
+            s.address = "Street " + to_string(rng.below(100)) + ", City " + to_string(rng.below(10)) + ", PIN " + to_string(560000 + rng.below(1000));
+            s.bloodGroup = bloodGroups[rng.below(bloodGroupCount)];
+
+            // Randomly assign course
+            uint32_t courseIndex = rng.below(static_cast<uint32_t>(courses.size()));
+            const Course& course = courses[courseIndex];
+            s.courseId = courseIds[courseIndex];
+
+            // Randomly assign admission type
+            s.admissionTypeId = (rng.below(2) == 0) ? ADMISSION_KCET : ADMISSION_MANAGEMENT;
+
+            s.feesPaid = calculateFees(course, s.admissionTypeId);
+
+            s.totalMarks = 300.0 + rng.below(200) + rng.below(100) / 100.0; // Marks between 300-499.99
+            s.rankObtained = 1 + rng.below(5000); // Rank between 1-5000
+            s.expectedPackage = 3.0 + rng.below(100) / 10.0; // Package between 3.0 and 12.9 LPA
+        }
+    };
+
+    size_t threadCount = max(1u, thread::hardware_concurrency());
+    threadCount = max<size_t>(1, min(threadCount, count / MIN_GENERATE_ROWS_PER_THREAD));
+    if (threadCount == 1) {
+        fillRows(0, count, seed);
+    } else {
+        vector<thread> workers;
+        for (size_t t = 0; t < threadCount; ++t) {
+            workers.emplace_back(fillRows, count * t / threadCount, count * (t + 1) / threadCount, seed + t * 0x632BE59BD9B4E019ULL);
+        }
+        for (auto& w : workers) w.join();
+    }
+
+    // Saved by a snapshot alone (below), so nothing older may be left to replay over it
+    bool snapshotOnly = foldJournalBeforeBulkChange();
+    students.reserve(students.size() + count);
+    const uint32_t firstSlot = static_cast<uint32_t>(students.size());
+    vector<uint32_t> added;
+    added.reserve(count);
+    size_t reassigned = 0;
+    // Derived phone numbers repeat every 10^9 student numbers, and stepping
+    // one past an older record's may land on a later row's, so rows check
+    // the numbers earlier rows kept too. Derived emails hold the student
+    // number and cannot collide within the batch.
+    unordered_set<uint64_t> batchPhones;
+    batchPhones.reserve(count);
+    for (auto& s : batch) {
+        if (findStudentSlot(s.studentID) != StudentKeyIndex::NOT_FOUND) continue;
+        // Older records (entered by hand or loaded from a file) may hold a
+        // derived contact: step past them
+        bool taken = false;
+        uint64_t phone = stoull(s.phoneNumber);
+        while (phoneIndex.find(s.phoneNumber) != StudentKeyIndex::NOT_FOUND || batchPhones.count(phone)) {
+            phone = 9000000000ULL + (phone - 9000000000ULL + 1) % 1000000000ULL;
+            s.phoneNumber = to_string(phone);
+            taken = true;
+        }
+        batchPhones.insert(phone);
+        if (emailIndex.find(s.email) != StudentKeyIndex::NOT_FOUND) {
+            string base = s.email;
+            for (uint32_t k = 2; emailIndex.find(s.email) != StudentKeyIndex::NOT_FOUND; ++k) {
+                s.email = base;
+                s.email.insert(base.find('@'), "." + to_string(k));
+            }
+            taken = true;
+        }
+        reassigned += taken;
+        noteCourseChanged(s.courseId);
+        added.push_back(static_cast<uint32_t>(students.size()));
+        students.push_back(move(s));
+    }
+    if (added.size() < firstSlot) {
+        for (uint32_t slot : added) indexStudent(slot); // Cheaper than re-indexing the larger store
+    } else {
+        rebuildStudentIndexes();
+    }
+    out << added.size() << " sample students generated.\n";
+    if (reassigned > 0) {
+        out << reassigned << " of them got another phone number or email, theirs being already registered.\n";
+    }
+    // A snapshot is cheaper than journaling every generated record. Without
+    // one, journal them after all so they and their events reach the disk.
+    if (!snapshotOnly || !compactStudentStore('A', added)) {
+        for (uint32_t slot : added) journalStudentWrite('A', students[slot]);
+    }
+    return true;
+}
+
+// Function to display course details and fees
+void displayCourseDetails() {
+    if (courses.empty()) {
+        cout << "\nNo engineering courses defined.\n";
+        return;
+    }
+    cout << "\n---- Engineering Courses and Fees ----\n";
+    cout << "------------------------------------------------------------------\n";
+    cout << left << setw(40) << "Course Name"
+         << left << setw(15) << "KCET Fees"
+         << left << setw(15) << "Mgmt Fees" << endl;
+    cout << "------------------------------------------------------------------\n";
+    for (const auto& c : courses) {
+        cout << left << setw(40) << c.courseName
+             << fixed << setprecision(2) << left << setw(15) << c.kcetFees
+             << fixed << setprecision(2) << left << setw(15) << c.managementFees << endl;
+    }
+    cout << "------------------------------------------------------------------\n";
+    cout << "Management admission discount: " << fixed << setprecision(1) << MANAGEMENT_DISCOUNT_PERCENTAGE << "%\n";
+    cout << "------------------------------------------------------------------\n";
+}
+
+// Function to count admissions by type
+void countAdmissionsByType() {
+    ensureAllShardsLoaded();
+    if (liveStudentCount() == 0) {
+        cout << "\nNo student records to count.\n";
+        return;
+    }
+    OutputBuffer out(cout);
+    renderAdmissionStatistics(out);
+}
+
+// Reads the live counters; no student records are scanned
+void countAdmissions(size_t& kcetCount, size_t& managementCount) {
+    kcetCount = admissionAggregates.byType(ADMISSION_KCET).count;
+    managementCount = admissionAggregates.byType(ADMISSION_MANAGEMENT).count;
+}
+
+// Totals can be negative (feesPaid is not range checked), so the sign goes
+// first and the digits come from the magnitude
+void renderFees(OutputBuffer& out, int64_t feesPaise) {
+    if (feesPaise < 0) out << '-';
+    uint64_t paise = feesPaise < 0 ? 0 - static_cast<uint64_t>(feesPaise) : static_cast<uint64_t>(feesPaise);
+    out << paise / 100 << '.' << char('0' + paise % 100 / 10) << char('0' + paise % 10);
+}
+
+// Admission dashboard: counts and fee totals by type, course and course x type,
+// plus blood group counts. Everything comes from admissionAggregates.
+void renderAdmissionStatistics(OutputBuffer& out) {
+    size_t kcetCount, managementCount;
+    countAdmissions(kcetCount, managementCount);
+    out << "\n--- Admission Statistics ---\n";
+    out << "Total students admitted through KCET: " << kcetCount << '\n';
+    out << "Total students admitted through Management: " << managementCount << '\n';
+    out << "----------------------------\n";
+
+    out << "\nBy admission type (students, fees collected INR):\n";
+    for (uint16_t t = 0; t < admissionTypes.size(); ++t) {
+        AggregateCell c = admissionAggregates.byType(t);
+        if (c.count == 0) continue;
+        out << "  " << admissionTypes.name(t) << ": " << c.count << ", ";
+        renderFees(out, c.feesPaise);
+        out << '\n';
+    }
+    out << "\nBy course (students, fees collected INR):\n";
+    for (uint16_t courseId = 0; courseId < courseNames.size(); ++courseId) {
+        AggregateCell c = admissionAggregates.byCourse(courseId);
+        if (c.count == 0) continue;
+        out << "  " << courseNames.name(courseId) << ": " << c.count << ", ";
+        renderFees(out, c.feesPaise);
+        out << '\n';
+        for (uint16_t t = 0; t < admissionTypes.size(); ++t) {
+            AggregateCell ct = admissionAggregates.byCourseAndType(courseId, t);
+            if (ct.count == 0) continue;
+            out << "      " << admissionTypes.name(t) << ": " << ct.count << ", ";
+            renderFees(out, ct.feesPaise);
+            out << '\n';
+        }
+    }
+    out << "\nBy blood group (students):\n";
+    for (const auto& entry : admissionAggregates.bloodGroupCounts()) {
+        out << "  " << entry.first << ": " << entry.second << '\n';
+    }
+    out << "----------------------------\n";
+}
+
+// --- Column Statistics ---
+
+// Returns column copies of the current records, rebuilding them only if a
+// record changed since the last call
+const StudentColumns& studentColumns() {
+    lock_guard<mutex> lock(columnCacheMutex);
+    if (columnCache.version == storeVersion) return columnCache;
+    size_t n = liveStudentCount();
+    StudentColumns& c = columnCache;
+    c.totalMarks.resize(n);
+    c.expectedPackage.resize(n);
+    c.feesPaid.resize(n);
+    c.rankObtained.resize(n);
+    c.courseId.resize(n);
+    c.admissionTypeId.resize(n);
+    c.slot.resize(n);
+    for (uint32_t slot = 0, i = 0; slot < students.size(); ++slot) {
+        const Student& s = students[slot];
+        if (s.deleted) continue;
+        c.slot[i] = slot;
+        c.totalMarks[i] = s.totalMarks;
+        c.expectedPackage[i] = s.expectedPackage;
+        c.feesPaid[i] = s.feesPaid;
+        c.rankObtained[i] = s.rankObtained;
+        c.courseId[i] = s.courseId;
+        c.admissionTypeId[i] = s.admissionTypeId;
+        i++;
+    }
+    c.version = storeVersion;
+    return c;
+}
+
+ColumnScan scanColumnScalar(const double* values, size_t n) {
+    ColumnScan scan;
+    if (n == 0) return scan;
+    scan.min = scan.max = values[0];
+    for (size_t i = 0; i < n; ++i) {
+        scan.sum += values[i];
+        scan.min = min(scan.min, values[i]);
+        scan.max = max(scan.max, values[i]);
+    }
+    return scan;
+}
+
+double squaredDeviationScalar(const double* values, size_t n, double mean) {
+    double total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double d = values[i] - mean;
+        total += d * d;
+    }
+    return total;
+}
+
+void histogramScalar(const double* values, size_t n, double low, double scale, size_t* bins) {
+    for (size_t i = 0; i < n; ++i) {
+        // Clamp before the cast: NaN and out-of-range values must not become an index
+        double position = (values[i] - low) * scale;
+        int bin = position > 0 ? static_cast<int>(min(position, double(HISTOGRAM_BINS - 1))) : 0;
+        bins[bin]++;
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+bool cpuHasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+// Sum, min and max, 16 doubles per iteration across four independent
+// accumulators so the adds are not serialized on one register
+__attribute__((target("avx2"))) ColumnScan scanColumnAvx2(const double* values, size_t n) {
+    if (n < 16) return scanColumnScalar(values, n);
+    __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+    __m256d sum2 = _mm256_setzero_pd(), sum3 = _mm256_setzero_pd();
+    __m256d lo = _mm256_set1_pd(values[0]), hi = lo;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256d a = _mm256_loadu_pd(values + i);
+        __m256d b = _mm256_loadu_pd(values + i + 4);
+        __m256d c = _mm256_loadu_pd(values + i + 8);
+        __m256d d = _mm256_loadu_pd(values + i + 12);
+        sum0 = _mm256_add_pd(sum0, a);
+        sum1 = _mm256_add_pd(sum1, b);
+        sum2 = _mm256_add_pd(sum2, c);
+        sum3 = _mm256_add_pd(sum3, d);
+        lo = _mm256_min_pd(lo, _mm256_min_pd(_mm256_min_pd(a, b), _mm256_min_pd(c, d)));
+        hi = _mm256_max_pd(hi, _mm256_max_pd(_mm256_max_pd(a, b), _mm256_max_pd(c, d)));
+    }
+    alignas(32) double sums[4], mins[4], maxs[4];
+    _mm256_store_pd(sums, _mm256_add_pd(_mm256_add_pd(sum0, sum1), _mm256_add_pd(sum2, sum3)));
+    _mm256_store_pd(mins, lo);
+    _mm256_store_pd(maxs, hi);
+    ColumnScan scan;
+    scan.sum = sums[0] + sums[1] + sums[2] + sums[3];
+    scan.min = min(min(mins[0], mins[1]), min(mins[2], mins[3]));
+    scan.max = max(max(maxs[0], maxs[1]), max(maxs[2], maxs[3]));
+    for (; i < n; ++i) {
+        scan.sum += values[i];
+        scan.min = min(scan.min, values[i]);
+        scan.max = max(scan.max, values[i]);
+    }
+    return scan;
+}
+
+__attribute__((target("avx2,fma"))) double squaredDeviationAvx2(const double* values, size_t n, double mean) {
+    __m256d m = _mm256_set1_pd(mean);
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d a = _mm256_sub_pd(_mm256_loadu_pd(values + i), m);
+        __m256d b = _mm256_sub_pd(_mm256_loadu_pd(values + i + 4), m);
+        acc0 = _mm256_fmadd_pd(a, a, acc0);
+        acc1 = _mm256_fmadd_pd(b, b, acc1);
+    }
+    alignas(32) double parts[4];
+    _mm256_store_pd(parts, _mm256_add_pd(acc0, acc1));
+    return parts[0] + parts[1] + parts[2] + parts[3] + squaredDeviationScalar(values + i, n - i, mean);
+}
+
+// Bin indices are computed four at a time; the counter increments stay scalar
+__attribute__((target("avx2"))) void histogramAvx2(const double* values, size_t n, double low, double scale, size_t* bins) {
+    __m256d lowV = _mm256_set1_pd(low);
+    __m256d scaleV = _mm256_set1_pd(scale);
+    __m256d firstBin = _mm256_setzero_pd();
+    __m256d lastBin = _mm256_set1_pd(HISTOGRAM_BINS - 1);
+    alignas(16) int32_t index[4];
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d scaled = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(values + i), lowV), scaleV);
+        // Clamp in double before converting, as the scalar path does; max_pd returns
+        // its second operand for NaN, so NaN lands in bin 0
+        scaled = _mm256_min_pd(_mm256_max_pd(scaled, firstBin), lastBin);
+        _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm256_cvttpd_epi32(scaled));
+        bins[index[0]]++;
+        bins[index[1]]++;
+        bins[index[2]]++;
+        bins[index[3]]++;
+    }
+    histogramScalar(values + i, n - i, low, scale, bins);
+}
+#endif
+
+ColumnScan scanColumn(const double* values, size_t n) {
+#ifdef HAVE_AVX2_KERNELS
+    if (cpuHasAvx2()) return scanColumnAvx2(values, n);
+#endif
+    return scanColumnScalar(values, n);
+}
+
+double squaredDeviation(const double* values, size_t n, double mean) {
+#ifdef HAVE_AVX2_KERNELS
+    if (cpuHasAvx2() && __builtin_cpu_supports("fma")) return squaredDeviationAvx2(values, n, mean);
+#endif
+    return squaredDeviationScalar(values, n, mean);
+}
+
+void histogram(const double* values, size_t n, double low, double scale, size_t* bins) {
+#ifdef HAVE_AVX2_KERNELS
+    if (cpuHasAvx2()) return histogramAvx2(values, n, low, scale, bins);
+#endif
+    histogramScalar(values, n, low, scale, bins);
+}
+
+// Mean, min, max, standard deviation, percentiles and an equal-width histogram
+ColumnStatistics computeColumnStatistics(const vector<double>& column) {
+    ColumnStatistics stats;
+    size_t n = column.size();
+    stats.count = n;
+    if (n == 0) return stats;
+    ColumnScan scan = scanColumn(column.data(), n);
+    stats.mean = scan.sum / n;
+    stats.min = scan.min;
+    stats.max = scan.max;
+    stats.stddev = sqrt(squaredDeviation(column.data(), n, stats.mean) / n);
+    double width = stats.max - stats.min;
+    histogram(column.data(), n, stats.min, width > 0 ? HISTOGRAM_BINS / width : 0.0, stats.histogram);
+
+    // Percentiles via successive nth_element calls, each on the upper remainder
+    vector<double> sorted(column);
+    size_t from = 0;
+    for (size_t p = 0; p < sizeof(REPORTED_PERCENTILES) / sizeof(REPORTED_PERCENTILES[0]); ++p) {
+        size_t k = min(n - 1, static_cast<size_t>(REPORTED_PERCENTILES[p] / 100.0 * n));
+        nth_element(sorted.begin() + from, sorted.begin() + k, sorted.end());
+        stats.percentiles[p] = sorted[k];
+        from = k;
+    }
+    return stats;
+}
+
+void renderColumnStatistics(OutputBuffer& out, const char* title, const ColumnStatistics& stats) {
+    out << "\n--- " << title << " ---\n";
+    out << "Count: " << stats.count << '\n';
+    if (stats.count == 0) return;
+    out << "Mean: ";
+    out.fixed(stats.mean) << "  Std Dev: ";
+    out.fixed(stats.stddev) << "  Min: ";
+    out.fixed(stats.min) << "  Max: ";
+    out.fixed(stats.max) << '\n';
+    out << "Percentiles:";
+    for (size_t p = 0; p < sizeof(REPORTED_PERCENTILES) / sizeof(REPORTED_PERCENTILES[0]); ++p) {
+        out << "  p" << static_cast<int>(REPORTED_PERCENTILES[p]) << "=";
+        out.fixed(stats.percentiles[p]);
+    }
+    out << '\n';
+    size_t tallest = *max_element(stats.histogram, stats.histogram + HISTOGRAM_BINS);
+    double width = (stats.max - stats.min) / HISTOGRAM_BINS;
+    for (int b = 0; b < HISTOGRAM_BINS; ++b) {
+        out << "  [";
+        out.fixed(stats.min + b * width) << ", ";
+        out.fixed(stats.min + (b + 1) * width) << (b == HISTOGRAM_BINS - 1 ? "] " : ") ");
+        size_t bar = tallest ? stats.histogram[b] * 40 / tallest : 0;
+        for (size_t i = 0; i < bar; ++i) out << '#';
+        out << ' ' << stats.histogram[b] << '\n';
+    }
+}
+
+// Function to show statistics of marks, expected package and fees
+void displayStudentStatistics() {
+    ensureAllShardsLoaded();
+    if (liveStudentCount() == 0) {
+        cout << "\nNo student records to summarize.\n";
+        return;
+    }
+    const StudentColumns& columns = studentColumns();
+    OutputBuffer out(cout);
+    renderColumnStatistics(out, "Total Marks", computeColumnStatistics(columns.totalMarks));
+    renderColumnStatistics(out, "Expected Package (LPA)", computeColumnStatistics(columns.expectedPackage));
+    renderColumnStatistics(out, "Fees Paid (INR)", computeColumnStatistics(columns.feesPaid));
+}
+
+// Runs body repeats times and returns the mean wall time of one run
+double averageMilliseconds(int repeats, const function<void()>& body) {
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) body();
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / repeats;
+}
+
+// Times the reduction and histogram kernels on a synthetic column, scalar
+// against AVX2, and checks both give the same answers
+int runStatisticsBenchmark(size_t rows) {
+    vector<double> column(rows);
+    FastRandom rng(12345);
+    for (auto& v : column) v = 300.0 + rng.below(20000) / 100.0;
+
+    const int repeats = 10;
+    auto report = [rows](const char* kernel, double scalarMs, double vectorMs) {
+        double gigabytes = rows * sizeof(double) / 1e9;
+        cout << left << setw(20) << kernel << right << fixed << setprecision(3)
+             << setw(12) << scalarMs << " ms" << setw(10) << gigabytes / (scalarMs / 1000) << " GB/s"
+             << setw(12) << vectorMs << " ms" << setw(10) << gigabytes / (vectorMs / 1000) << " GB/s"
+             << setw(9) << setprecision(2) << scalarMs / vectorMs << "x\n";
+    };
+
+    cout << "Statistics kernel benchmark over " << rows << " doubles (" << repeats << " runs each)\n";
+#ifdef HAVE_AVX2_KERNELS
+    if (!cpuHasAvx2()) {
+        cout << "This CPU does not support AVX2; only the scalar kernels are available.\n";
+        return 0;
+    }
+    cout << left << setw(20) << "Kernel" << right << setw(25) << "Scalar" << setw(25) << "AVX2" << setw(10) << "Speedup\n";
+    volatile double sink = 0;
+    ColumnScan scalarScan, vectorScan;
+    double scalarMs = averageMilliseconds(repeats, [&] { scalarScan = scanColumnScalar(column.data(), rows); });
+    double vectorMs = averageMilliseconds(repeats, [&] { vectorScan = scanColumnAvx2(column.data(), rows); });
+    report("sum/min/max", scalarMs, vectorMs);
+
+    double mean = scalarScan.sum / rows;
+    double scalarDev = 0, vectorDev = 0;
+    scalarMs = averageMilliseconds(repeats, [&] { scalarDev = squaredDeviationScalar(column.data(), rows, mean); });
+    vectorMs = averageMilliseconds(repeats, [&] { vectorDev = squaredDeviation(column.data(), rows, mean); });
+    report("std deviation", scalarMs, vectorMs);
+    sink = scalarDev + vectorDev;
+    (void)sink;
+
+    size_t scalarBins[HISTOGRAM_BINS] = {}, vectorBins[HISTOGRAM_BINS] = {};
+    double scale = HISTOGRAM_BINS / (scalarScan.max - scalarScan.min);
+    scalarMs = averageMilliseconds(repeats, [&] {
+        histogramScalar(column.data(), rows, scalarScan.min, scale, scalarBins);
+    });
+    vectorMs = averageMilliseconds(repeats, [&] {
+        histogramAvx2(column.data(), rows, scalarScan.min, scale, vectorBins);
+    });
+    report("histogram", scalarMs, vectorMs);
+
+    bool same = scalarScan.min == vectorScan.min && scalarScan.max == vectorScan.max &&
+                fabs(scalarScan.sum - vectorScan.sum) <= 1e-9 * fabs(scalarScan.sum) &&
+                fabs(scalarDev - vectorDev) <= 1e-9 * fabs(scalarDev) &&
+                equal(scalarBins, scalarBins + HISTOGRAM_BINS, vectorBins);
+    cout << (same ? "Scalar and AVX2 results agree.\n" : "Warning: scalar and AVX2 results differ!\n");
+    return same ? 0 : 1;
+#else
+    double ms = averageMilliseconds(repeats, [&] { scanColumnScalar(column.data(), rows); });
+    cout << "AVX2 kernels are not built for this target. Scalar sum/min/max: " << fixed << setprecision(3) << ms << " ms\n";
+    return 0;
+#endif
+}
+
+// --- Query Engine ---
+// A query is the AND of column predicates, optionally ordered and limited:
+//   course="Civil Engineering" and marks>=400 and type=KCET order by rank limit 50
+// Fields: course and type (= and != only), marks, rank, package and fees
+// (=, !=, <, <=, >, >=). Keywords are case-insensitive and values holding
+// spaces are double-quoted. Queries run over studentColumns() one predicate
+// at a time: the first scans its whole column into a selection vector of row
+// numbers, and each later one only re-checks the rows still selected,
+// compacting the vector in place. Course and type go first, being the
+// narrowest columns and usually the most selective.
+
+const char* const QUERY_FIELD_NAMES[] = {"course", "type", "marks", "rank", "package", "fees"};
+
+struct QueryToken {
+    string text;
+    bool quoted = false;
+};
+
+bool isQueryOperatorChar(char c) {
+    return c == '=' || c == '!' || c == '<' || c == '>';
+}
+
+// Splits query text into words, numbers, "quoted strings" and operators
+bool tokenizeQuery(string_view text, vector<QueryToken>& tokens, string& error) {
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (c == ' ' || c == '\t') {
+            i++;
+            continue;
+        }
+        QueryToken token;
+        if (c == '"') {
+            token.quoted = true;
+            for (i++;; i++) {
+                if (i == text.size()) {
+                    error = "missing closing quote";
+                    return false;
+                }
+                if (text[i] == '"') {
+                    if (i + 1 < text.size() && text[i + 1] == '"') {
+                        token.text += '"'; // Doubled quote, as in students.txt
+                        i++;
+                        continue;
+                    }
+                    i++;
+                    break;
+                }
+                token.text += text[i];
+            }
+        } else {
+            size_t start = i;
+            bool isOperator = isQueryOperatorChar(c);
+            while (i < text.size() && text[i] != ' ' && text[i] != '\t' && text[i] != '"' &&
+                   isQueryOperatorChar(text[i]) == isOperator) {
+                i++;
+            }
+            token.text.assign(text.substr(start, i - start));
+        }
+        tokens.push_back(move(token));
+    }
+    return true;
+}
+
+bool parseQueryOp(string_view text, QueryOp& op) {
+    static const pair<string_view, QueryOp> ops[] = {{"=", QueryOp::Eq},  {"==", QueryOp::Eq}, {"!=", QueryOp::Ne},
+                                                     {"<>", QueryOp::Ne}, {"<", QueryOp::Lt},  {"<=", QueryOp::Le},
+                                                     {">", QueryOp::Gt},  {">=", QueryOp::Ge}};
+    for (const auto& entry : ops) {
+        if (entry.first == text) {
+            op = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseQuery(string_view text, QueryPlan& plan, string& error) {
+    vector<QueryToken> tokens;
+    if (!tokenizeQuery(text, tokens, error)) return false;
+    plan = QueryPlan();
+    size_t i = 0;
+    auto atKeyword = [&tokens, &i](string_view word) {
+        return i < tokens.size() && !tokens[i].quoted && tokens[i].text.size() == word.size() &&
+               startsWithIgnoringCase(tokens[i].text, word);
+    };
+    auto keyword = [&](string_view word) {
+        if (!atKeyword(word)) return false;
+        i++;
+        return true;
+    };
+    auto field = [&](QueryField& f) {
+        for (size_t k = 0; k < sizeof(QUERY_FIELD_NAMES) / sizeof(QUERY_FIELD_NAMES[0]); ++k) {
+            if (keyword(QUERY_FIELD_NAMES[k])) {
+                f = static_cast<QueryField>(k);
+                return true;
+            }
+        }
+        error = i < tokens.size() ? "unknown field '" + tokens[i].text + "'" : "expected a field name at the end";
+        error += " (fields: course, type, marks, rank, package, fees)";
+        return false;
+    };
+
+    while (i < tokens.size() && !atKeyword("order") && !atKeyword("limit")) {
+        if (!plan.predicates.empty() && !keyword("and")) {
+            error = "expected 'and', 'order by' or 'limit' before '" + tokens[i].text + "'";
+            return false;
+        }
+        QueryPredicate p;
+        if (!field(p.field)) return false;
+        const char* name = QUERY_FIELD_NAMES[static_cast<int>(p.field)];
+        if (i >= tokens.size() || tokens[i].quoted || !parseQueryOp(tokens[i].text, p.op)) {
+            error = string("expected a comparison after '") + name + "'";
+            return false;
+        }
+        i++;
+        if (i >= tokens.size()) {
+            error = string("expected a value after '") + name + "'";
+            return false;
+        }
+        const QueryToken& value = tokens[i++];
+        if (p.field == QueryField::Course || p.field == QueryField::Type) {
+            if (p.op != QueryOp::Eq && p.op != QueryOp::Ne) {
+                error = string("'") + name + "' can only be compared with = or !=";
+                return false;
+            }
+            p.text = value.text;
+        } else if (value.quoted || parseNumber(value.text, p.number) != FieldStatus::Ok) {
+            error = string("expected a number for '") + name + "', got '" + value.text + "'";
+            return false;
+        }
+        plan.predicates.push_back(move(p));
+    }
+    if (keyword("order")) {
+        if (!keyword("by")) {
+            error = "expected 'by' after 'order'";
+            return false;
+        }
+        if (!field(plan.orderBy)) return false;
+        if (plan.orderBy == QueryField::Course || plan.orderBy == QueryField::Type) {
+            error = "can only order by marks, rank, package or fees";
+            return false;
+        }
+        plan.ordered = true;
+        if (keyword("desc")) {
+            plan.descending = true;
+        } else {
+            keyword("asc");
+        }
+    }
+    if (keyword("limit")) {
+        if (i >= tokens.size() || parseNumber(tokens[i].text, plan.limit) != FieldStatus::Ok) {
+            error = "expected a row count after 'limit'";
+            return false;
+        }
+        i++;
+    }
+    if (i < tokens.size()) {
+        error = "unexpected '" + tokens[i].text + "'";
+        return false;
+    }
+    return true;
+}
+
+// Calls body with a test implementing `op value`, so the kernels below are
+// instantiated once per operator and never branch on it per row
+template <typename V, typename Body>
+size_t withComparison(QueryOp op, V value, Body body) {
+    switch (op) {
+        case QueryOp::Eq: return body([value](auto v) { return v == value; });
+        case QueryOp::Ne: return body([value](auto v) { return v != value; });
+        case QueryOp::Lt: return body([value](auto v) { return v < value; });
+        case QueryOp::Le: return body([value](auto v) { return v <= value; });
+        case QueryOp::Gt: return body([value](auto v) { return v > value; });
+        default: return body([value](auto v) { return v >= value; });
+    }
+}
+
+// Writes the rows of column[0, n) passing the test to sel; returns how many.
+// Every row is written and the count only advances on a match, so there is
+// no data-dependent branch to mispredict.
+template <typename T, typename V>
+size_t selectRowsScalar(const T* column, size_t n, QueryOp op, V value, uint32_t* sel) {
+    return withComparison(op, value, [&](auto test) {
+        size_t count = 0;
+        for (size_t row = 0; row < n; ++row) {
+            sel[count] = static_cast<uint32_t>(row);
+            count += test(column[row]);
+        }
+        return count;
+    });
+}
+
+// Keeps the rows of sel[0, count) passing the test, in order; returns how many
+template <typename T, typename V>
+size_t refineRows(const T* column, QueryOp op, V value, uint32_t* sel, size_t count) {
+    return withComparison(op, value, [&](auto test) {
+        size_t kept = 0;
+        for (size_t k = 0; k < count; ++k) {
+            uint32_t row = sel[k];
+            sel[kept] = row;
+            kept += test(column[row]);
+        }
+        return kept;
+    });
+}
+
+#ifdef HAVE_AVX2_KERNELS
+// Lane numbers of the set bits of a 4-bit compare mask, packed to the front
+alignas(16) const uint32_t SELECT_LANES[16][4] = {
+    {0, 0, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0}, {2, 0, 0, 0}, {0, 2, 0, 0}, {1, 2, 0, 0}, {0, 1, 2, 0},
+    {3, 0, 0, 0}, {0, 3, 0, 0}, {1, 3, 0, 0}, {0, 1, 3, 0}, {2, 3, 0, 0}, {0, 2, 3, 0}, {1, 2, 3, 0}, {0, 1, 2, 3}};
+
+// Compares four doubles per step and appends the matching row numbers with
+// one 16-byte store, so sel needs three spare entries past n
+template <int Compare>
+__attribute__((target("avx2,popcnt"))) size_t selectDoublesAvx2(const double* column, size_t n, QueryOp op,
+                                                                 double value, uint32_t* sel) {
+    __m256d v = _mm256_set1_pd(value);
+    size_t count = 0;
+    size_t row = 0;
+    for (; row + 4 <= n; row += 4) {
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(column + row), v, Compare));
+        __m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i*>(SELECT_LANES[mask]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sel + count), _mm_add_epi32(lanes, _mm_set1_epi32(static_cast<int>(row))));
+        count += _mm_popcnt_u32(mask);
+    }
+    size_t tail = selectRowsScalar(column + row, n - row, op, value, sel + count);
+    for (size_t k = count; k < count + tail; ++k) sel[k] += static_cast<uint32_t>(row);
+    return count + tail;
+}
+
+// Compares sixteen course or type IDs per step (= or != only). The 16-bit
+// results are packed to one bit per row and appended four rows at a time with
+// the same lane table, so sel needs three spare entries past n. Blocks with
+// no match, the common case for course=, cost one compare.
+__attribute__((target("avx2,popcnt"))) size_t selectIdsAvx2(const uint16_t* column, size_t n, QueryOp op,
+                                                             uint16_t value, uint32_t* sel) {
+    __m256i v = _mm256_set1_epi16(static_cast<short>(value));
+    uint32_t flip = op == QueryOp::Ne ? 0xFFFF : 0;
+    size_t count = 0;
+    size_t row = 0;
+    for (; row + 16 <= n; row += 16) {
+        __m256i equal = _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(column + row)), v);
+        __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(equal), _mm256_extracti128_si256(equal, 1));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(packed)) ^ flip;
+        if (mask == 0) continue;
+        for (int group = 0; group < 16; group += 4) {
+            uint32_t bits = (mask >> group) & 0xF;
+            __m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i*>(SELECT_LANES[bits]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sel + count),
+                             _mm_add_epi32(lanes, _mm_set1_epi32(static_cast<int>(row) + group)));
+            count += _mm_popcnt_u32(bits);
+        }
+    }
+    size_t tail = selectRowsScalar(column + row, n - row, op, value, sel + count);
+    for (size_t k = count; k < count + tail; ++k) sel[k] += static_cast<uint32_t>(row);
+    return count + tail;
+}
+#endif
+
+// First pass over a double column; sel must have room for n + 3 rows
+size_t selectDoubleRows(const double* column, size_t n, QueryOp op, double value, uint32_t* sel) {
+#ifdef HAVE_AVX2_KERNELS
+    if (cpuHasAvx2() && __builtin_cpu_supports("popcnt")) {
+        switch (op) {
+            case QueryOp::Eq: return selectDoublesAvx2<_CMP_EQ_OQ>(column, n, op, value, sel);
+            case QueryOp::Ne: return selectDoublesAvx2<_CMP_NEQ_UQ>(column, n, op, value, sel);
+            case QueryOp::Lt: return selectDoublesAvx2<_CMP_LT_OQ>(column, n, op, value, sel);
+            case QueryOp::Le: return selectDoublesAvx2<_CMP_LE_OQ>(column, n, op, value, sel);
+            case QueryOp::Gt: return selectDoublesAvx2<_CMP_GT_OQ>(column, n, op, value, sel);
+            default: return selectDoublesAvx2<_CMP_GE_OQ>(column, n, op, value, sel);
+        }
+    }
+#endif
+    return selectRowsScalar(column, n, op, value, sel);
+}
+
+// First pass over a course or type ID column; sel must have room for n + 3 rows
+size_t selectIdRows(const uint16_t* column, size_t n, QueryOp op, uint16_t value, uint32_t* sel) {
+#ifdef HAVE_AVX2_KERNELS
+    if ((op == QueryOp::Eq || op == QueryOp::Ne) && cpuHasAvx2() && __builtin_cpu_supports("popcnt")) {
+        return selectIdsAvx2(column, n, op, value, sel);
+    }
+#endif
+    return selectRowsScalar(column, n, op, value, sel);
+}
+
+const vector<double>& doubleQueryColumn(const StudentColumns& columns, QueryField field) {
+    if (field == QueryField::Marks) return columns.totalMarks;
+    if (field == QueryField::Package) return columns.expectedPackage;
+    return columns.feesPaid;
+}
+
+// Runs a parsed query over columns and returns the selected row numbers in
+// result order, at most plan.limit of them. matched gets the count before
+// the limit. Course and type names are looked up here, so the caller must
+// keep the dictionaries from changing (storeMutex, as for any query).
+vector<uint32_t> executeQuery(const QueryPlan& plan, const StudentColumns& columns, size_t& matched) {
+    size_t n = columns.totalMarks.size();
+    vector<const QueryPredicate*> order;
+    for (const auto& p : plan.predicates) order.push_back(&p);
+    stable_partition(order.begin(), order.end(), [](const QueryPredicate* p) {
+        return p->field == QueryField::Course || p->field == QueryField::Type;
+    });
+
+    vector<uint32_t> sel(n + 3); // Spare room for the AVX2 kernel's last store
+    size_t count = n;
+    if (order.empty()) {
+        for (size_t row = 0; row < n; ++row) sel[row] = static_cast<uint32_t>(row);
+    }
+    for (size_t k = 0; k < order.size() && count > 0; ++k) {
+        const QueryPredicate& p = *order[k];
+        bool first = k == 0;
+        if (p.field == QueryField::Course || p.field == QueryField::Type) {
+            bool isCourse = p.field == QueryField::Course;
+            const vector<uint16_t>& column = isCourse ? columns.courseId : columns.admissionTypeId;
+            uint16_t id = (isCourse ? courseNames : admissionTypes).find(p.text); // NOT_FOUND matches no row
+            count = first ? selectIdRows(column.data(), n, p.op, id, sel.data())
+                          : refineRows(column.data(), p.op, id, sel.data(), count);
+        } else if (p.field == QueryField::Rank) {
+            const int32_t* column = columns.rankObtained.data();
+            count = first ? selectRowsScalar(column, n, p.op, p.number, sel.data())
+                          : refineRows(column, p.op, p.number, sel.data(), count);
+        } else {
+            const double* column = doubleQueryColumn(columns, p.field).data();
+            count = first ? selectDoubleRows(column, n, p.op, p.number, sel.data())
+                          : refineRows(column, p.op, p.number, sel.data(), count);
+        }
+    }
+    sel.resize(count);
+    matched = count;
+
+    size_t shown = min(count, plan.limit);
+    if (plan.ordered) {
+        const int32_t* ranks = columns.rankObtained.data();
+        const double* values = plan.orderBy == QueryField::Rank ? nullptr : doubleQueryColumn(columns, plan.orderBy).data();
+        bool descending = plan.descending;
+        auto before = [ranks, values, descending](uint32_t a, uint32_t b) {
+            double x = values ? values[a] : ranks[a];
+            double y = values ? values[b] : ranks[b];
+            if (x != y) return descending ? x > y : x < y;
+            return a < b; // Ties keep record order
+        };
+        if (shown < count) {
+            partial_sort(sel.begin(), sel.begin() + shown, sel.end(), before);
+        } else {
+            sort(sel.begin(), sel.end(), before);
+        }
+    }
+    sel.resize(shown);
+    return sel;
+}
+
+// Parses and runs a query, writing one line per student:
+//   <id>,<name>,<course>,<type>,<marks>,<rank>
+bool runQuery(string_view text, ostream& out) {
+    QueryPlan plan;
+    string error;
+    if (!parseQuery(text, plan, error)) {
+        out << "Error: query: " << error << ".\n";
+        return false;
+    }
+    const StudentColumns& columns = studentColumns();
+    size_t matched;
+    vector<uint32_t> rows = executeQuery(plan, columns, matched);
+    OutputBuffer buffer(out);
+    for (uint32_t row : rows) {
+        const Student& s = students[columns.slot[row]];
+        buffer << s.studentID << ',' << s.name << ',' << courseName(s) << ',' << admissionTypeName(s) << ',';
+        buffer.fixed(s.totalMarks) << ',' << s.rankObtained << '\n';
+    }
+    buffer << matched << " student(s) matched";
+    if (rows.size() < matched) buffer << ", showing " << rows.size();
+    buffer << ".\n";
+    return true;
+}
+
+// A query restricted by course="..." can only match that course, so a
+// sharded store needs just its shard. Returns false if a shard it needs
+// could not be read.
+bool loadShardsForQuery(string_view text) {
+    QueryPlan plan;
+    string error;
+    if (parseQuery(text, plan, error)) {
+        for (const auto& p : plan.predicates) {
+            if (p.field == QueryField::Course && p.op == QueryOp::Eq) return ensureCourseShardLoaded(p.text);
+        }
+    }
+    return ensureAllShardsLoaded();
+}
+
+// Function to run a query typed by the operator
+void queryStudents() {
+    if (storedStudentCount() == 0) {
+        cout << "No students to query.\n";
+        return;
+    }
+    cout << "Fields: course, type (= or !=), marks, rank, package, fees (= != < <= > >=).\n";
+    cout << "Example: course=\"Civil Engineering\" and marks>=400 and type=KCET order by rank limit 50\n";
+    cout << "Enter query: ";
+    string query;
+    getline(cin, query);
+    loadShardsForQuery(query);
+    runQuery(query, cout);
+}
+
+// Times a few queries over synthetic columns and checks the AVX2 first passes
+// against the scalar ones
+int runQueryBenchmark(size_t rows) {
+    static const char* const courseList[] = {"Computer Science Engineering", "Electronics & Communication Engineering",
+                                             "Mechanical Engineering", "Civil Engineering"};
+    uint16_t courseIds[4];
+    for (int c = 0; c < 4; ++c) courseIds[c] = courseNames.intern(courseList[c]);
+    StudentColumns columns;
+    columns.totalMarks.resize(rows);
+    columns.expectedPackage.resize(rows);
+    columns.feesPaid.resize(rows);
+    columns.rankObtained.resize(rows);
+    columns.courseId.resize(rows);
+    columns.admissionTypeId.resize(rows);
+    columns.slot.resize(rows);
+    FastRandom rng(2024);
+    for (size_t i = 0; i < rows; ++i) {
+        columns.totalMarks[i] = 300.0 + rng.below(20000) / 100.0;
+        columns.expectedPackage[i] = 3.0 + rng.below(100) / 10.0;
+        columns.rankObtained[i] = 1 + static_cast<int32_t>(rng.below(200000));
+        columns.courseId[i] = courseIds[rng.below(4)];
+        columns.admissionTypeId[i] = static_cast<uint16_t>(rng.below(2));
+        columns.feesPaid[i] = 90000.0 + 10000.0 * rng.below(14);
+        columns.slot[i] = static_cast<uint32_t>(i);
+    }
+
+    static const char* const queries[] = {
+        "course=\"Civil Engineering\" and marks>=400 and type=KCET order by rank limit 50",
+        "marks>=490",
+        "package>12 and fees<150000 order by marks desc limit 10",
+        "rank<=1000 and course!=\"Mechanical Engineering\" order by rank",
+    };
+    const int repeats = 5;
+    cout << "Query benchmark over " << rows << " rows (" << repeats << " runs each)\n";
+    for (const char* text : queries) {
+        QueryPlan plan;
+        string error;
+        if (!parseQuery(text, plan, error)) {
+            cerr << "Error: query: " << error << ".\n";
+            return 1;
+        }
+        size_t matched = 0;
+        double ms = averageMilliseconds(repeats, [&] { executeQuery(plan, columns, matched); });
+        cout << fixed << setprecision(3) << setw(10) << ms << " ms " << setprecision(0) << setw(8)
+             << rows / (ms / 1000) / 1e6 << " M rows/s " << setw(10) << matched << " matched  " << text << "\n";
+    }
+
+    vector<uint32_t> scalarSel(rows + 3), vectorSel(rows + 3);
+    bool same = true;
+    auto comparePasses = [&](const char* what, const function<size_t(uint32_t*)>& scalar,
+                             const function<size_t(uint32_t*)>& dispatched) {
+        size_t scalarCount = 0, vectorCount = 0;
+        double scalarMs = averageMilliseconds(repeats, [&] { scalarCount = scalar(scalarSel.data()); });
+        double vectorMs = averageMilliseconds(repeats, [&] { vectorCount = dispatched(vectorSel.data()); });
+        cout << "First pass " << what << ": scalar " << setprecision(3) << scalarMs << " ms, dispatched " << vectorMs
+             << " ms (" << setprecision(2) << scalarMs / vectorMs << "x)\n";
+        same = same && scalarCount == vectorCount &&
+               equal(scalarSel.begin(), scalarSel.begin() + scalarCount, vectorSel.begin());
+    };
+    comparePasses("marks>=400",
+                  [&](uint32_t* sel) { return selectRowsScalar(columns.totalMarks.data(), rows, QueryOp::Ge, 400.0, sel); },
+                  [&](uint32_t* sel) { return selectDoubleRows(columns.totalMarks.data(), rows, QueryOp::Ge, 400.0, sel); });
+    comparePasses("course=\"Civil Engineering\"",
+                  [&](uint32_t* sel) { return selectRowsScalar(columns.courseId.data(), rows, QueryOp::Eq, courseIds[3], sel); },
+                  [&](uint32_t* sel) { return selectIdRows(columns.courseId.data(), rows, QueryOp::Eq, courseIds[3], sel); });
+    comparePasses("type!=KCET",
+                  [&](uint32_t* sel) { return selectRowsScalar(columns.admissionTypeId.data(), rows, QueryOp::Ne, ADMISSION_KCET, sel); },
+                  [&](uint32_t* sel) { return selectIdRows(columns.admissionTypeId.data(), rows, QueryOp::Ne, ADMISSION_KCET, sel); });
+    cout << (same ? "Scalar and dispatched selections agree.\n" : "Warning: scalar and dispatched selections differ!\n");
+    return same ? 0 : 1;
+}
+
+// --- Counselling (Seat Allocation) ---
+// A counselling round gives out the seats in seats.txt to the students listed
+// in preferences.txt. Candidates choose in rank order (higher marks first on
+// equal ranks): each gets the first course on their list that still has a
+// seat in their own quota, KCET or Management, or nothing if none does. The
+// allotment goes to allotment.txt and each course x quota reports its closing
+// rank. Seats and preferences are flat arrays of course IDs, so a round over
+// 200k candidates with 50 choices each takes a few tens of milliseconds and
+// can be rerun after editing either file.
+
+const char* const SEAT_FIELD_NAMES[] = {"courseName", "kcetSeats", "managementSeats"};
+const char* const PREFERENCE_FIELD_NAMES[] = {"studentID", "course"};
+
+void allocateSeats(const CounsellingInput& input, CounsellingResult& result) {
+    const auto& candidates = input.candidates;
+    vector<uint32_t> order(candidates.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<uint32_t>(i);
+    sort(order.begin(), order.end(), [&candidates](uint32_t a, uint32_t b) {
+        const CounsellingCandidate& x = candidates[a];
+        const CounsellingCandidate& y = candidates[b];
+        if (x.rank != y.rank) return x.rank < y.rank;
+        if (x.marks != y.marks) return x.marks > y.marks;
+        return a < b;
+    });
+
+    vector<uint32_t> remaining = input.seats;
+    result.allottedCourse.assign(candidates.size(), uint16_t(StringDictionary::NOT_FOUND));
+    result.allottedChoice.assign(candidates.size(), 0);
+    result.filled.assign(input.seats.size(), 0);
+    result.closingRank.assign(input.seats.size(), 0);
+    result.allotted = 0;
+    for (uint32_t i : order) {
+        const CounsellingCandidate& c = candidates[i];
+        if (c.quota >= QUOTA_COUNT) continue;
+        const uint16_t* choices = input.preferences.data() + c.firstPreference;
+        for (uint16_t k = 0; k < c.preferenceCount; ++k) {
+            size_t cell = choices[k] * QUOTA_COUNT + c.quota;
+            if (cell >= remaining.size() || remaining[cell] == 0) continue;
+            remaining[cell]--;
+            result.filled[cell]++;
+            result.closingRank[cell] = c.rank; // Candidates arrive in rank order
+            result.allottedCourse[i] = choices[k];
+            result.allottedChoice[i] = static_cast<uint16_t>(k + 1);
+            result.allotted++;
+            break;
+        }
+    }
+}
+
+// Reads seats.txt into per course x quota seat counts. Courses no student is
+// in are reported and skipped: no preference can name them, and adding them to
+// courseNames would change it under a shared lock.
+bool loadSeatMatrix(const string& path, vector<uint32_t>& seats) {
+    MappedFile file;
+    if (!file.open(path)) {
+        cerr << "Error: Could not open seat matrix " << path << ".\n";
+        return false;
     }
-    clearInputBuffer(); // Clear buffer after numeric input
+    seats.clear();
+    ParseErrorReport errors;
+    LineReader lines(file);
+    string_view line;
+    while (lines.next(line)) {
+        if (line.empty()) continue;
 
-    students.push_back(s);
-    cout << "Student record added successfully with ID: " << s.studentID << "!\n";
-    saveStudentsToFile(); // Save immediately after adding
+        vector<string_view> fields = splitFields(line, ',');
+        uint32_t quotaSeats[QUOTA_COUNT];
+        RowError error;
+        if (fields.size() < 3 || fields[0].empty()) {
+            error = {fields[0].empty() ? 0 : static_cast<int>(fields.size()), FieldStatus::Missing};
+        } else if (fields.size() > 3) {
+            error = {2, FieldStatus::TooMany};
+        } else {
+            for (size_t q = 0; q < QUOTA_COUNT && error.status == FieldStatus::Ok; ++q) {
+                FieldStatus status = parseNumber(fields[q + 1], quotaSeats[q]);
+                if (status != FieldStatus::Ok) error = {static_cast<int>(q + 1), status};
+            }
+        }
+        uint16_t courseId = StringDictionary::NOT_FOUND;
+        if (error.status == FieldStatus::Ok) {
+            courseId = courseNames.find(fields[0]);
+            if (courseId == StringDictionary::NOT_FOUND) error = {0, FieldStatus::Unknown};
+        }
+        if (error.status != FieldStatus::Ok) {
+            errors.add(error, lines.lineNumber(), line);
+            continue;
+        }
+        size_t cell = size_t(courseId) * QUOTA_COUNT;
+        if (cell + QUOTA_COUNT > seats.size()) seats.resize(cell + QUOTA_COUNT, 0);
+        for (size_t q = 0; q < QUOTA_COUNT; ++q) seats[cell + q] += quotaSeats[q];
+    }
+    errors.print(cerr, path, SEAT_FIELD_NAMES);
+    return true;
 }
 
-// Function to display all students
-void displayAllStudents() {
-    if (students.empty()) {
-        cout << "\nNo student records to display.\n";
-        return;
+// Reads preferences.txt into candidates drawn from the live students. Lines
+// naming an unknown course, or an unknown or already listed student, are
+// skipped. Known courses without seats stay in the list and are passed over.
+bool loadPreferences(const string& path, CounsellingInput& input) {
+    MappedFile file;
+    if (!file.open(path)) {
+        cerr << "Error: Could not open preferences " << path << ".\n";
+        return false;
     }
-    cout << "\n---- All Student Records ------\n";
-    for (const auto& s : students) {
-        cout << "--------------------------------\n";
-        cout << "Student ID: " << s.studentID << endl;
-        cout << "Name: " << s.name << endl;
-        cout << "Phone: " << s.phoneNumber << endl;
-        cout << "Email: " << s.email << endl;
-        cout << "Address: " << s.address << endl;
-        cout << "Blood Group: " << s.bloodGroup << endl;
-        cout << "Course: " << s.admittedCourse << endl;
-        cout << "Admission Type: " << s.admissionType << endl;
-        cout << "Total Marks: " << fixed << setprecision(2) << s.totalMarks << endl;
-        cout << "Rank: " << s.rankObtained << endl;
-        cout << "Expected Package: " << fixed << setprecision(2) << s.expectedPackage << " LPA\n";
-        cout << "Fees Paid: " << fixed << setprecision(2) << s.feesPaid << " INR\n";
+    input.candidates.clear();
+    input.preferences.clear();
+    vector<uint8_t> listed(students.size(), 0);
+    ParseErrorReport errors;
+    LineReader lines(file);
+    string_view line;
+    while (lines.next(line)) {
+        if (line.empty()) continue;
+
+        vector<string_view> fields = splitFields(line, ',');
+        uint32_t slot = findStudentSlot(fields[0]);
+        RowError error;
+        if (fields.size() < 2 || fields[0].empty()) {
+            error = {fields[0].empty() ? 0 : 1, FieldStatus::Missing};
+        } else if (fields.size() > UINT16_MAX) {
+            error = {1, FieldStatus::TooMany};
+        } else if (slot == StudentKeyIndex::NOT_FOUND) {
+            error = {0, FieldStatus::Unknown};
+        } else if (listed[slot]) {
+            error = {0, FieldStatus::Repeated};
+        }
+        size_t first = input.preferences.size();
+        for (size_t f = 1; f < fields.size() && error.status == FieldStatus::Ok; ++f) {
+            uint16_t courseId = courseNames.find(fields[f]);
+            if (courseId == StringDictionary::NOT_FOUND) {
+                error = {1, FieldStatus::Unknown};
+            } else {
+                input.preferences.push_back(courseId);
+            }
+        }
+        if (error.status != FieldStatus::Ok) {
+            input.preferences.resize(first);
+            errors.add(error, lines.lineNumber(), line);
+            continue;
+        }
+        listed[slot] = 1;
+        const Student& s = students[slot];
+        input.candidates.push_back({s.rankObtained, s.totalMarks, slot, s.admissionTypeId,
+                                    static_cast<uint16_t>(input.preferences.size() - first),
+                                    static_cast<uint32_t>(first)});
     }
-    cout << "--------------------------------\n";
+    errors.print(cerr, path, PREFERENCE_FIELD_NAMES);
+    return true;
 }
 
-// Function to search student by ID
-void searchStudentByID() {
-    if (students.empty()) {
-        cout << "No students to search.\n";
-        return;
+// Runs one round from the given files, writes the allotment as
+//   <student ID>,<course>,<quota>,<rank>,<choice number>
+// and prints seats filled and closing ranks per course. The caller holds
+// storeMutex, shared or exclusive: records and dictionaries are only read, and
+// writers of the allotment file take allotmentFileMutex.
+bool runCounselling(const string& seatsPath, const string& preferencesPath, const string& allotmentPath, ostream& out) {
+    CounsellingInput input;
+    if (!loadSeatMatrix(seatsPath, input.seats) || !loadPreferences(preferencesPath, input)) {
+        out << "Error: counselling needs " << seatsPath << " and " << preferencesPath << ".\n";
+        return false;
     }
-    string idToSearch;
-    cout << "Enter student ID to search (e.g., SID1001): ";
-    getline(cin, idToSearch);
+    CounsellingResult result;
+    auto start = chrono::steady_clock::now();
+    allocateSeats(input, result);
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
 
-    bool found = false;
-    for (const auto& s : students) {
-        if (s.studentID == idToSearch) {
-            cout << "\n--- Student Found ---\n";
-            cout << "Student ID: " << s.studentID << endl;
-            cout << "Name: " << s.name << endl;
-            cout << "Phone: " << s.phoneNumber << endl;
-            cout << "Email: " << s.email << endl;
-            cout << "Address: " << s.address << endl;
-            cout << "Blood Group: " << s.bloodGroup << endl;
-            cout << "Course: " << s.admittedCourse << endl;
-            cout << "Admission Type: " << s.admissionType << endl;
-            cout << "Total Marks: " << fixed << setprecision(2) << s.totalMarks << endl;
-            cout << "Rank: " << s.rankObtained << endl;
-            cout << "Expected Package: " << fixed << setprecision(2) << s.expectedPackage << " LPA\n";
-            cout << "Fees Paid: " << fixed << setprecision(2) << s.feesPaid << " INR\n";
-            found = true;
-            break;
+    unique_lock<mutex> writing(allotmentFileMutex);
+    ofstream file(allotmentPath, ios::binary);
+    if (!file) {
+        out << "Error: Could not write " << allotmentPath << ".\n";
+        return false;
+    }
+    {
+        OutputBuffer buffer(file);
+        for (size_t i = 0; i < input.candidates.size(); ++i) {
+            if (result.allottedChoice[i] == 0) continue;
+            const CounsellingCandidate& c = input.candidates[i];
+            buffer << students[c.student].studentID << ',' << courseNames.name(result.allottedCourse[i]) << ','
+                   << admissionTypes.name(c.quota) << ',' << c.rank << ',' << result.allottedChoice[i] << '\n';
         }
     }
-    if (!found) {
-        cout << "Student with ID " << idToSearch << " not found.\n";
+    if (!file.flush()) {
+        out << "Error: Could not write " << allotmentPath << ".\n";
+        return false;
     }
+    file.close();
+    writing.unlock();
+
+    OutputBuffer buffer(out);
+    buffer << "\n--- Counselling Round ---\n";
+    for (uint16_t courseId = 0; courseId * QUOTA_COUNT < input.seats.size(); ++courseId) {
+        size_t cell = courseId * QUOTA_COUNT;
+        if (input.seats[cell] + input.seats[cell + 1] == 0) continue;
+        buffer << courseNames.name(courseId) << '\n';
+        for (uint16_t q = 0; q < QUOTA_COUNT; ++q) {
+            buffer << "  " << admissionTypes.name(q) << ": " << result.filled[cell + q] << " of "
+                   << input.seats[cell + q] << " seats filled";
+            if (result.filled[cell + q] > 0) buffer << ", closing rank " << result.closingRank[cell + q];
+            buffer << '\n';
+        }
+    }
+    buffer << "Allotted " << result.allotted << " of " << input.candidates.size() << " candidates in ";
+    buffer.fixed(elapsed.count(), 3) << " ms; allotment written to " << allotmentPath << ".\n";
+    return true;
 }
 
-// Function to update student details (by ID)
-void updateStudentDetails() {
-    if (students.empty()) {
-        cout << "No students to update.\n";
-        return;
+// Function to run a counselling round on seats.txt and preferences.txt
+void runSeatAllocation() {
+    ensureAllShardsLoaded();
+    cout << "Allotting seats from " << SEAT_MATRIX_FILE << " by the preferences in " << PREFERENCES_FILE << ".\n";
+    runCounselling(SEAT_MATRIX_FILE, PREFERENCES_FILE, ALLOTMENT_FILE, cout);
+}
+
+// Times allocateSeats on synthetic candidates who each rank every course,
+// with seats for 60% of them (70% of each course's seats in the KCET quota)
+int runCounsellingBenchmark(size_t candidateCount, size_t courseCount) {
+    CounsellingInput input;
+    size_t seatsPerCourse = max<size_t>(1, candidateCount * 6 / 10 / courseCount);
+    input.seats.resize(courseCount * QUOTA_COUNT);
+    for (size_t c = 0; c < courseCount; ++c) {
+        input.seats[c * QUOTA_COUNT + ADMISSION_KCET] = static_cast<uint32_t>(seatsPerCourse * 7 / 10);
+        input.seats[c * QUOTA_COUNT + ADMISSION_MANAGEMENT] = static_cast<uint32_t>(seatsPerCourse - seatsPerCourse * 7 / 10);
+    }
+    FastRandom rng(22);
+    vector<uint16_t> choices(courseCount);
+    input.candidates.resize(candidateCount);
+    input.preferences.reserve(candidateCount * courseCount);
+    for (size_t i = 0; i < candidateCount; ++i) {
+        for (size_t c = 0; c < courseCount; ++c) choices[c] = static_cast<uint16_t>(c);
+        for (size_t c = courseCount - 1; c > 0; --c) swap(choices[c], choices[rng.below(static_cast<uint32_t>(c + 1))]);
+        CounsellingCandidate& candidate = input.candidates[i];
+        candidate.rank = 1 + static_cast<int32_t>(rng.below(static_cast<uint32_t>(candidateCount)));
+        candidate.marks = 300.0 + rng.below(20000) / 100.0;
+        candidate.student = static_cast<uint32_t>(i);
+        candidate.quota = rng.below(10) < 7 ? ADMISSION_KCET : ADMISSION_MANAGEMENT;
+        candidate.preferenceCount = static_cast<uint16_t>(courseCount);
+        candidate.firstPreference = static_cast<uint32_t>(input.preferences.size());
+        input.preferences.insert(input.preferences.end(), choices.begin(), choices.end());
     }
-    string idToUpdate;
-    cout << "Enter student ID to update: ";
-    getline(cin, idToUpdate);
 
-    bool found = false;
-    for (auto& s : students) { // Use reference to modify
-        if (s.studentID == idToUpdate) {
-            found = true;
-            cout << "\n--- Updating Student (ID: " << s.studentID << ") ---\n";
-            cout << "Enter new name (current: " << s.name << "): ";
-            getline(cin, s.name);
-            cout << "Enter new phone number (current: " << s.phoneNumber << "): ";
-            getline(cin, s.phoneNumber);
-            cout << "Enter new email (current: " << s.email << "): ";
-            getline(cin, s.email);
-            cout << "Enter new address (current: " << s.address << "): ";
-            getline(cin, s.address);
-            cout << "Enter new blood group (current: " << s.bloodGroup << "): ";
-            getline(cin, s.bloodGroup);
-
-            // Re-select course and admission type to update fees if needed
-            if (courses.empty()) {
-                cout << "No courses available to choose from. Course will remain: " << s.admittedCourse << endl;
-            } else {
-                displayCourseDetails();
-                cout << "Enter new course for admission (current: " << s.admittedCourse << "): ";
-                string newCourseName;
-                getline(cin, newCourseName);
-                bool newCourseFound = false;
-                Course newSelectedCourse;
-                for (const auto& c : courses) {
-                    if (c.courseName == newCourseName) {
-                        newSelectedCourse = c;
-                        newCourseFound = true;
-                        break;
-                    }
-                }
-                if (!newCourseFound) {
-                    cout << "Error: New course not found. Keeping old course: " << s.admittedCourse << endl;
-                } else {
-                    s.admittedCourse = newCourseName;
-                    cout << "Enter new admission type (KCET/Management) (current: " << s.admissionType << "): ";
-                    getline(cin, s.admissionType);
-                    while (s.admissionType != "KCET" && s.admissionType != "Management") {
-                        cout << "Invalid admission type. Please enter 'KCET' or 'Management': ";
-                        getline(cin, s.admissionType);
-                    }
+    const int repeats = 5;
+    CounsellingResult result;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) allocateSeats(input, result);
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
 
-                    if (s.admissionType == "KCET") {
-                        s.feesPaid = newSelectedCourse.kcetFees;
-                    } else { // Management
-                        s.feesPaid = newSelectedCourse.managementFees * (1 - MANAGEMENT_DISCOUNT_PERCENTAGE / 100.0);
-                    }
-                    cout << "New Fees calculated: " << fixed << setprecision(2) << s.feesPaid << " INR\n";
-                }
-            }
+    size_t firstChoice = 0;
+    for (uint16_t choice : result.allottedChoice) firstChoice += choice == 1;
+    cout << "Counselling benchmark: " << candidateCount << " candidates x " << courseCount << " courses, "
+         << seatsPerCourse * courseCount << " seats\n";
+    cout << "Allotted " << result.allotted << " (" << firstChoice << " to their first choice) in " << fixed
+         << setprecision(3) << elapsed.count() / repeats << " ms per round (" << repeats << " runs)\n";
+    return 0;
+}
 
-            cout << "Enter new total marks (current: " << fixed << setprecision(2) << s.totalMarks << "): ";
-            while (!(cin >> s.totalMarks) || s.totalMarks < 0 || s.totalMarks > 500) {
-                cout << "Invalid marks. Please enter a number between 0 and 500: ";
-                cin.clear();
-                clearInputBuffer();
-            }
-            cout << "Enter new rank (current: " << s.rankObtained << "): ";
-            while (!(cin >> s.rankObtained) || s.rankObtained <= 0) {
-                cout << "Invalid rank. Please enter a positive integer: ";
-                cin.clear();
-                clearInputBuffer();
-            }
-            cout << "Enter new expected package (current: " << fixed << setprecision(2) << s.expectedPackage << "): ";
-            while (!(cin >> s.expectedPackage) || s.expectedPackage < 0) {
-                cout << "Invalid package. Please enter a non-negative number: ";
-                cin.clear();
-                clearInputBuffer();
+// --- Fee Audit ---
+// feesPaid is fixed when a student is added or updated, so editing
+// courses.txt leaves older records charging old fees. The audit joins every
+// student with the current course table: the table side is tiny, so it is
+// built as a dense array of expected fees indexed by courseId x admission
+// type, and the probe side is one pass over the records split across
+// threads. Amounts are compared in paise, as in admissionAggregates.
+
+vector<FeeMismatch> auditStudentFees() {
+    size_t types = admissionTypes.size();
+    vector<int64_t> expectedPaise(courseNames.size() * types, UNPRICED_FEES);
+    for (const auto& c : courses) {
+        size_t row = courseNames.find(c.courseName) * types;
+        // Only the quotas have fees; any other type read from disk stays unpriced
+        for (uint16_t t = 0; t < min(types, QUOTA_COUNT); ++t) expectedPaise[row + t] = llround(calculateFees(c, t) * 100.0);
+    }
+
+    size_t threadCount = max(1u, thread::hardware_concurrency());
+    threadCount = max<size_t>(1, min(threadCount, students.size() / MIN_AUDIT_ROWS_PER_THREAD));
+    vector<vector<FeeMismatch>> found(threadCount);
+    auto probe = [&expectedPaise, types](size_t begin, size_t end, vector<FeeMismatch>& out) {
+        for (size_t slot = begin; slot < end; ++slot) {
+            const Student& s = students[slot];
+            if (s.deleted) continue;
+            int64_t expected = expectedPaise[s.courseId * types + s.admissionTypeId];
+            if (expected == UNPRICED_FEES || llround(s.feesPaid * 100.0) != expected) {
+                out.push_back({static_cast<uint32_t>(slot), expected});
             }
-            clearInputBuffer(); // Clear buffer after numeric input
+        }
+    };
+    if (threadCount == 1) {
+        probe(0, students.size(), found[0]);
+    } else {
+        vector<thread> workers;
+        for (size_t t = 0; t < threadCount; ++t) {
+            workers.emplace_back(probe, students.size() * t / threadCount, students.size() * (t + 1) / threadCount,
+                                 ref(found[t]));
+        }
+        for (auto& w : workers) w.join();
+    }
 
-            cout << "Student details updated successfully!\n";
-            saveStudentsToFile(); // Save changes
-            break;
+    vector<FeeMismatch> mismatches = move(found[0]); // Slot order, like the ranges
+    for (size_t t = 1; t < threadCount; ++t) mismatches.insert(mismatches.end(), found[t].begin(), found[t].end());
+    return mismatches;
+}
+
+// Lists the first `limit` mismatches as <id>,<course>,<type>,<paid>,<expected>
+// and sums up the rest
+void renderFeeAudit(OutputBuffer& out, const vector<FeeMismatch>& mismatches, size_t limit) {
+    size_t unpriced = 0, unknownType = 0;
+    int64_t underPaise = 0, overPaise = 0;
+    for (size_t i = 0; i < mismatches.size(); ++i) {
+        const FeeMismatch& m = mismatches[i];
+        const Student& s = students[m.slot];
+        int64_t paidPaise = llround(s.feesPaid * 100.0);
+        if (m.expectedPaise == UNPRICED_FEES) {
+            if (s.admissionTypeId >= QUOTA_COUNT) unknownType++;
+            else unpriced++;
+        } else if (paidPaise < m.expectedPaise) {
+            underPaise += m.expectedPaise - paidPaise;
+        } else {
+            overPaise += paidPaise - m.expectedPaise;
+        }
+        if (i >= limit) continue;
+        out << s.studentID << ',' << courseName(s) << ',' << admissionTypeName(s) << ',';
+        out.fixed(s.feesPaid) << ',';
+        if (m.expectedPaise == UNPRICED_FEES) {
+            out << (s.admissionTypeId >= QUOTA_COUNT ? "unknown admission type\n" : "course not offered\n");
+        } else {
+            renderFees(out, m.expectedPaise);
+            out << '\n';
         }
     }
-    if (!found) {
-        cout << "Student with ID " << idToUpdate << " not found.\n";
+    if (mismatches.size() > limit) out << "... " << mismatches.size() - limit << " more\n";
+    out << mismatches.size() << " of " << liveStudentCount() << " students do not match the course table";
+    if (unpriced > 0) out << " (" << unpriced << " in courses no longer offered)";
+    if (unknownType > 0) out << " (" << unknownType << " with an admission type other than KCET or Management)";
+    out << ".\nUndercharged INR ";
+    renderFees(out, underPaise);
+    out << ", overcharged INR ";
+    renderFees(out, overPaise);
+    out << ".\n";
+}
+
+// Sets feesPaid to the audited amount; students of courses no longer offered,
+// or with an unknown admission type, keep theirs. The caller holds storeMutex
+// exclusively. Small batches are journaled, large ones are cheaper to write
+// as a fresh snapshot once the journal has been folded into one.
+size_t applyFeeCorrections(const vector<FeeMismatch>& mismatches) {
+    vector<uint32_t> slots;
+    for (const FeeMismatch& m : mismatches) {
+        if (m.expectedPaise != UNPRICED_FEES) slots.push_back(m.slot);
+    }
+    if (slots.empty()) return 0;
+    bool snapshotOnly = slots.size() > JOURNAL_COMPACT_THRESHOLD && foldJournalBeforeBulkChange();
+    for (const FeeMismatch& m : mismatches) {
+        if (m.expectedPaise == UNPRICED_FEES) continue;
+        Student& s = students[m.slot];
+        admissionAggregates.remove(s);
+        s.feesPaid = m.expectedPaise / 100.0;
+        admissionAggregates.add(s);
+        noteCourseChanged(s.courseId);
     }
+    storeVersion++;
+    if (!snapshotOnly || !compactStudentStore('U', slots)) {
+        for (uint32_t slot : slots) journalStudentWrite('U', students[slot]);
+    }
+    return slots.size();
 }
 
-// Function to delete student by ID
-void deleteStudentByID() {
-    if (students.empty()) {
-        cout << "No students to delete.\n";
+// Function to audit fees against courses.txt and optionally fix them
+void auditFees() {
+    ensureAllShardsLoaded();
+    if (liveStudentCount() == 0) {
+        cout << "No students to audit.\n";
         return;
     }
-    string idToDelete;
-    cout << "Enter student ID to delete: ";
-    getline(cin, idToDelete);
+    auto start = chrono::steady_clock::now();
+    vector<FeeMismatch> mismatches = auditStudentFees();
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    {
+        OutputBuffer buffer(cout);
+        renderFeeAudit(buffer, mismatches, SEARCH_RESULT_LIMIT);
+        buffer << "Audit took ";
+        buffer.fixed(elapsed.count(), 3) << " ms.\n";
+    }
+    size_t fixable = 0;
+    for (const FeeMismatch& m : mismatches) fixable += m.expectedPaise != UNPRICED_FEES;
+    if (fixable == 0) return;
+    cout << "Reprice " << fixable << " student(s) to the current course fees? (y/n): ";
+    string answer;
+    getline(cin, answer);
+    if (answer != "y" && answer != "Y") {
+        cout << "Nothing was changed.\n";
+        return;
+    }
+    unique_lock<shared_mutex> lock(storeMutex);
+    size_t corrected = applyFeeCorrections(mismatches);
+    lock.unlock();
+    cout << corrected << " student(s) repriced.\n";
+}
 
-    // Use a lambda function to find the student by ID
-    auto it = remove_if(students.begin(), students.end(),
-                        [idToDelete](const Student& s) { return s.studentID == idToDelete; });
+// --- Duplicate Contact Report ---
+// phoneIndex and emailIndex keep new duplicates out, but records loaded from
+// older files may already share them. The report makes one pass over the
+// records, inserting each into a fresh index; a record whose key is taken is
+// paired with the record holding it. Pairs are grouped by holder, so every
+// cluster is listed once, first member first.
 
-    if (it != students.end()) {
-        students.erase(it, students.end());
-        cout << "Student with ID " << idToDelete << " deleted successfully.\n";
-        saveStudentsToFile(); // Save changes
-    } else {
-        cout << "Student with ID " << idToDelete << " not found.\n";
+size_t reportDuplicateContacts(OutputBuffer& out, string Student::*field, StudentKeyIndex::KeyNormalizer normalize,
+                               const char* label) {
+    StudentKeyIndex seen(students, field, normalize);
+    vector<pair<uint32_t, uint32_t>> pairs; // (first holder, later record with the same key)
+    seen.rebuild([&](uint32_t slot) { pairs.emplace_back(seen.find(students[slot].*field), slot); });
+    stable_sort(pairs.begin(), pairs.end(),
+                [](const pair<uint32_t, uint32_t>& a, const pair<uint32_t, uint32_t>& b) { return a.first < b.first; });
+
+    size_t clusters = 0;
+    for (size_t i = 0; i < pairs.size(); ++clusters) {
+        const Student& first = students[pairs[i].first];
+        out << label << ' ' << first.*field << ": " << first.studentID;
+        for (uint32_t holder = pairs[i].first; i < pairs.size() && pairs[i].first == holder; ++i) {
+            out << ", " << students[pairs[i].second].studentID;
+        }
+        out << '\n';
     }
+    out << clusters << ' ' << label << "(s) shared by " << clusters + pairs.size() << " students.\n";
+    return clusters;
 }
 
-// Function to sort students by rank
-void sortStudentsByRank() {
-    if (students.empty()) {
-        cout << "No students to sort.\n";
+// Function to list every phone number and email held by more than one student
+void displayDuplicateContacts() {
+    ensureAllShardsLoaded();
+    if (liveStudentCount() == 0) {
+        cout << "No students to check.\n";
         return;
     }
-    // Sorts students in ascending order of rank
-    sort(students.begin(), students.end(), [](const Student& a, const Student& b) {
-        return a.rankObtained < b.rankObtained;
-    });
-    cout << "Students sorted by rank (ascending).\n";
-    displayAllStudents(); // Display sorted list
+    OutputBuffer buffer(cout);
+    buffer << "\n--- Duplicate Phone Numbers ---\n";
+    reportDuplicateContacts(buffer, &Student::phoneNumber, normalizePhoneKey, "phone number");
+    buffer << "\n--- Duplicate Emails ---\n";
+    reportDuplicateContacts(buffer, &Student::email, normalizeEmailKey, "email");
 }
 
-// Function to generate sample students
-void generateSampleStudents(int count) {
-    if (courses.empty()) {
-        cout << "Cannot generate sample students, no courses defined. Please ensure 'courses.txt' has data or default courses are initialized.\n";
-        return;
+// --- Batch Command Mode ---
+// ex2 --batch [file|-] reads one command per line from a file or stdin:
+//   add <name>,<phone>,<email>,<address>,<blood group>,<course>,<KCET|Management>,<marks>,<rank>,<package>
+//       (fields holding commas are quoted as in students.txt: "Street 1, City 2")
+//   update <id> <field>=<value>[;<field>=<value>...]
+//          fields: name phone email address blood course type marks rank package
+//   delete <id>
+//   withdraw <course>
+//   search <id>
+//   sort [limit]      list students in rank order from the rank index (records stay where they are)
+//   top <k>
+//   ranks <from> <to> [limit] [in <course>]
+//   marks <min> <max> [limit] [in <course>]
+//   find <name prefix or name/email substring>
+//   query <filter> [order by <field> [asc|desc]] [limit <n>]  (see parseQuery)
+//   allot [seats file] [preferences file] [allotment file]  (a counselling round)
+//   audit [limit]     list students whose fees differ from courses.txt
+//   reprice           set those students' fees to the course table's
+//   duplicates [phone|email]  list students sharing a phone number or email
+//   list [first] [count]  skip `first` students, then list up to `count`
+//   export <file>
+//   count
+//   stats
+//   describe
+//   generate <count>
+//   save
+// Blank lines and lines starting with '#' are skipped. Results go to stdout and
+// a per-command throughput summary is printed at the end.
+
+struct BatchOpStats {
+    size_t count = 0;
+    size_t failed = 0;
+    double seconds = 0;
+};
+
+vector<string_view> splitFields(string_view text, char delimiter) {
+    vector<string_view> fields;
+    size_t pos = 0;
+    while (true) {
+        size_t next = text.find(delimiter, pos);
+        fields.push_back(text.substr(pos, next == string_view::npos ? string_view::npos : next - pos));
+        if (next == string_view::npos) break;
+        pos = next + 1;
     }
-    srand(static_cast<unsigned int>(time(0))); // Seed for random numbers
+    return fields;
+}
+
+// Same limits the interactive prompts enforce
+bool validateStudentNumbers(const Student& s, string& error) {
+    if (s.totalMarks < 0 || s.totalMarks > 500) error = "marks must be between 0 and 500";
+    else if (s.rankObtained <= 0) error = "rank must be a positive integer";
+    else if (s.expectedPackage < 0) error = "package must be non-negative";
+    else return true;
+    return false;
+}
+
+// Sets one named field for the update command
+bool applyStudentField(Student& s, string_view field, string_view value, string& error) {
+    if (field == "name") s.name.assign(value);
+    else if (field == "phone") s.phoneNumber.assign(value);
+    else if (field == "email") s.email.assign(value);
+    else if (field == "address") s.address.assign(value);
+    else if (field == "blood") s.bloodGroup.assign(value);
+    else if (field == "course" || field == "type") {
+        StringDictionary& dictionary = (field == "course") ? courseNames : admissionTypes;
+        uint16_t id = dictionary.find(value);
+        if (id == StringDictionary::NOT_FOUND) {
+            error = string(field) + " '" + string(value) + "' not found";
+            return false;
+        }
+        (field == "course" ? s.courseId : s.admissionTypeId) = id;
+    }
+    else if (field == "marks") return parseNumberField(value, s.totalMarks, "marks", error);
+    else if (field == "rank") return parseNumberField(value, s.rankObtained, "rank", error);
+    else if (field == "package") return parseNumberField(value, s.expectedPackage, "package", error);
+    else {
+        error = "unknown field '" + string(field) + "'";
+        return false;
+    }
+    return true;
+}
 
-    string names[] = {"Alice", "Bob", "Charlie", "Diana", "Eve", "Frank", "Grace", "Heidi", "Ivan", "Judy",
-                      "Kevin", "Liam", "Mia", "Noah", "Olivia", "Peter", "Quinn", "Rachel", "Sam", "Tina",
-                      "Uma", "Victor", "Wendy", "Xavier", "Yara", "Zack", "Anna", "Ben", "Chloe", "David",
-                      "Emily", "Fred", "Gina", "Harry", "Iris", "Jack", "Karen", "Leo", "Mona", "Nate"}; // More names
-    string bloodGroups[] = {"A+", "B+", "AB+", "O+", "A-", "B-", "AB-", "O-"};
+// Looks up the course, checks the admission type and recomputes fees
+bool assignCourseAndFees(Student& s, string& error) {
+    const Course* course = findCourse(s.courseId);
+    if (course == nullptr) {
+        error = "course '" + courseName(s) + "' is not offered";
+        return false;
+    }
+    if (s.admissionTypeId != ADMISSION_KCET && s.admissionTypeId != ADMISSION_MANAGEMENT) {
+        error = "admission type must be KCET or Management";
+        return false;
+    }
+    s.feesPaid = calculateFees(*course, s.admissionTypeId);
+    return true;
+}
 
-    for (int i = 0; i < count; ++i) {
+// Runs one batch command. Returns false (after printing why) if it failed.
+bool executeBatchCommand(string_view command, string_view args, ostream& out) {
+    string error;
+    if (command == "add") {
+        // Same quoting as students.txt, so an address with commas is written "Street 1, City 2"
+        string_view raw[MAX_CSV_FIELDS];
+        int fieldCount;
+        splitCsvRecord(args.data(), args.data() + args.size(), raw, MAX_CSV_FIELDS, fieldCount);
+        if (fieldCount != 10) {
+            out << "Error: add needs 10 comma-separated fields, got " << fieldCount << ".\n";
+            return false;
+        }
+        string scratch[10];
+        string_view fields[10];
+        for (int i = 0; i < 10; ++i) fields[i] = unquoteCsvField(raw[i], scratch[i]);
         Student s;
-        s.studentID = generateStudentID();
-        s.name = names[i % (sizeof(names) / sizeof(names[0]))] + " " + to_string(100 + rand() % 900); // Add random number for more unique names
-        s.phoneNumber = "98" + to_string(10000000 + rand() % 90000000); // Dummy number
-        s.email = s.name.substr(0, s.name.find(" ") != string::npos ? s.name.find(" ") : s.name.length()) + to_string(rand() % 1000) + "@example.com";
-        s.address = "Street " + to_string(rand() % 100) + ", City " + to_string(rand() % 10) + ", PIN " + to_string(560000 + rand() % 1000);
-        s.bloodGroup = bloodGroups[rand() % (sizeof(bloodGroups) / sizeof(bloodGroups[0]))];
-
-        // Randomly assign course
-        int courseIndex = rand() % courses.size();
-        s.admittedCourse = courses[courseIndex].courseName;
-
-        // Randomly assign admission type
-        s.admissionType = (rand() % 2 == 0) ? "KCET" : "Management";
-
-        if (s.admissionType == "KCET") {
-            s.feesPaid = courses[courseIndex].kcetFees;
+        s.name.assign(fields[0]);
+        s.phoneNumber.assign(fields[1]);
+        s.email.assign(fields[2]);
+        s.address.assign(fields[3]);
+        s.bloodGroup.assign(fields[4]);
+        if (!applyStudentField(s, "course", fields[5], error) ||
+            !applyStudentField(s, "type", fields[6], error) ||
+            !parseNumberField(fields[7], s.totalMarks, "marks", error) ||
+            !parseNumberField(fields[8], s.rankObtained, "rank", error) ||
+            !parseNumberField(fields[9], s.expectedPackage, "package", error) ||
+            !validateStudentNumbers(s, error) || !assignCourseAndFees(s, error) ||
+            !checkUniqueContacts(s, StudentKeyIndex::NOT_FOUND, error)) {
+            out << "Error: add failed: " << error << ".\n";
+            return false;
+        }
+        if (!generateStudentID(s.studentID)) {
+            out << "Error: add failed: no student IDs are left.\n";
+            return false;
+        }
+        insertStudentRecord(s);
+        journalStudentWrite('A', s);
+        out << "Added " << s.studentID << "\n";
+        return true;
+    }
+    if (command == "update") {
+        size_t space = args.find(' ');
+        string id(args.substr(0, space));
+        uint32_t slot = findStudentSlot(id);
+        if (slot == StudentKeyIndex::NOT_FOUND) {
+            out << "Error: student " << id << " not found.\n";
+            return false;
+        }
+        Student s = students[slot];
+        bool courseChanged = false;
+        string_view assignments = space == string_view::npos ? string_view() : args.substr(space + 1);
+        for (string_view assignment : splitFields(assignments, ';')) {
+            size_t eq = assignment.find('=');
+            if (eq == string_view::npos) {
+                out << "Error: update expects field=value, got '" << assignment << "'.\n";
+                return false;
+            }
+            string_view field = assignment.substr(0, eq);
+            if (!applyStudentField(s, field, assignment.substr(eq + 1), error)) {
+                out << "Error: update failed: " << error << ".\n";
+                return false;
+            }
+            courseChanged = courseChanged || field == "course" || field == "type";
+        }
+        if (!validateStudentNumbers(s, error) || (courseChanged && !assignCourseAndFees(s, error)) ||
+            !checkUniqueContacts(s, slot, error)) {
+            out << "Error: update failed: " << error << ".\n";
+            return false;
+        }
+        replaceStudentRecord(slot, move(s));
+        journalStudentWrite('U', students[slot]);
+        out << "Updated " << id << "\n";
+        return true;
+    }
+    if (command == "delete") {
+        string id(args);
+        if (!removeStudentRecord(id)) {
+            out << "Error: student " << id << " not found.\n";
+            return false;
+        }
+        journalStudentDelete(id);
+        compactStudentSlotsIfDue();
+        out << "Deleted " << id << "\n";
+        return true;
+    }
+    if (command == "withdraw") {
+        uint16_t courseId = courseNames.find(args);
+        if (courseId == StringDictionary::NOT_FOUND) {
+            out << "Error: no students have been admitted to '" << args << "'.\n";
+            return false;
+        }
+        vector<string> withdrawnIds;
+        size_t withdrawn = withdrawCourseStudents(courseId, &withdrawnIds);
+        if (withdrawn > 0) journalCourseWithdrawal(string(args), withdrawnIds);
+        out << "Withdrew " << withdrawn << " students from " << args << "\n";
+        return true;
+    }
+    if (command == "search") {
+        uint32_t slot = findStudentSlot(args);
+        if (slot == StudentKeyIndex::NOT_FOUND) {
+            out << "Error: student " << args << " not found.\n";
+            return false;
+        }
+        printStudentDetails(out, students[slot]);
+        return true;
+    }
+    if (command == "find") {
+        if (args.empty()) {
+            out << "Error: usage is 'find <text>'.\n";
+            return false;
+        }
+        textIndex.search(args, SEARCH_RESULT_LIMIT, [&out](uint32_t slot) {
+            const Student& s = students[slot];
+            out << s.studentID << "," << s.name << "," << s.email << "\n";
+        });
+        return true;
+    }
+    if (command == "query") {
+        return runQuery(args, out);
+    }
+    if (command == "allot") {
+        vector<string_view> paths = args.empty() ? vector<string_view>() : splitFields(args, ' ');
+        if (paths.size() > 3) {
+            out << "Error: usage is 'allot [seats file] [preferences file] [allotment file]'.\n";
+            return false;
+        }
+        string seatsPath = paths.size() > 0 ? string(paths[0]) : SEAT_MATRIX_FILE;
+        string preferencesPath = paths.size() > 1 ? string(paths[1]) : PREFERENCES_FILE;
+        string allotmentPath = paths.size() > 2 ? string(paths[2]) : ALLOTMENT_FILE;
+        return runCounselling(seatsPath, preferencesPath, allotmentPath, out);
+    }
+    if (command == "audit" || command == "reprice") {
+        size_t limit = SEARCH_RESULT_LIMIT;
+        if (command == "audit" && !args.empty() && !parseNumberField(args, limit, "limit", error)) {
+            out << "Error: usage is 'audit [limit]'.\n";
+            return false;
+        }
+        vector<FeeMismatch> mismatches = auditStudentFees();
+        if (command == "audit") {
+            OutputBuffer buffer(out);
+            renderFeeAudit(buffer, mismatches, limit);
+        } else {
+            size_t repriced = applyFeeCorrections(mismatches); // Saved by snapshot or journal, never lost
+            out << "Repriced " << repriced << " students\n";
+        }
+        return true;
+    }
+    if (command == "duplicates") {
+        if (!args.empty() && args != "phone" && args != "email") {
+            out << "Error: usage is 'duplicates [phone|email]'.\n";
+            return false;
+        }
+        OutputBuffer buffer(out);
+        if (args != "email") reportDuplicateContacts(buffer, &Student::phoneNumber, normalizePhoneKey, "phone number");
+        if (args != "phone") reportDuplicateContacts(buffer, &Student::email, normalizeEmailKey, "email");
+        return true;
+    }
+    if (command == "top" || command == "sort" || command == "ranks" || command == "marks") {
+        // An optional trailing "in <course>" restricts the scan to one course
+        uint16_t courseId = ANY_COURSE;
+        size_t in = args.find(" in ");
+        if ((command == "ranks" || command == "marks") && in != string_view::npos) {
+            string_view course = args.substr(in + 4);
+            courseId = courseNames.find(course);
+            if (courseId == StringDictionary::NOT_FOUND) {
+                out << "Error: no students have been admitted to '" << course << "'.\n";
+                return false;
+            }
+            args = args.substr(0, in);
+        }
+        vector<string_view> values = args.empty() ? vector<string_view>() : splitFields(args, ' ');
+        int fromRank = 1, toRank = INT32_MAX;
+        double minMarks = 0, maxMarks = 0;
+        size_t limit = SIZE_MAX;
+        bool ok;
+        if (command == "top") {
+            ok = values.size() == 1 && parseNumberField(values[0], limit, "k", error);
+        } else if (command == "sort") {
+            ok = values.size() <= 1 && (values.empty() || parseNumberField(values[0], limit, "limit", error));
+        } else if (command == "ranks") {
+            ok = (values.size() == 2 || values.size() == 3) &&
+                 parseNumberField(values[0], fromRank, "from", error) &&
+                 parseNumberField(values[1], toRank, "to", error) &&
+                 (values.size() == 2 || parseNumberField(values[2], limit, "limit", error));
         } else {
-            s.feesPaid = courses[courseIndex].managementFees * (1 - MANAGEMENT_DISCOUNT_PERCENTAGE / 100.0);
+            ok = (values.size() == 2 || values.size() == 3) &&
+                 parseNumberField(values[0], minMarks, "min", error) &&
+                 parseNumberField(values[1], maxMarks, "max", error) &&
+                 (values.size() == 2 || parseNumberField(values[2], limit, "limit", error));
+        }
+        if (!ok) {
+            out << "Error: usage is 'top <k>', 'sort [limit]', 'ranks <from> <to> [limit] [in <course>]' or "
+                   "'marks <min> <max> [limit] [in <course>]'.\n";
+            return false;
+        }
+        auto print = [&out](const Student& s) {
+            out << s.rankObtained << "," << s.studentID << "," << s.name << "," << fixed << setprecision(2) << s.totalMarks << "\n";
+        };
+        if (command == "marks") {
+            visitStudentsByMarks(minMarks, maxMarks, courseId, limit, print);
+        } else {
+            RankPageCursor cursor;
+            visitStudentsByRank(fromRank, toRank, courseId, limit, cursor, print);
+        }
+        return true;
+    }
+    if (command == "list") {
+        vector<string_view> values = args.empty() ? vector<string_view>() : splitFields(args, ' ');
+        size_t first = 0, count = SIZE_MAX;
+        if (values.size() > 2 || (values.size() > 0 && !parseNumberField(values[0], first, "first", error)) ||
+            (values.size() > 1 && !parseNumberField(values[1], count, "count", error))) {
+            out << "Error: usage is 'list [first] [count]'.\n";
+            return false;
+        }
+        // first counts live students, so tombstones before them do not shift the page
+        size_t cursor = 0;
+        for (size_t skipped = 0; cursor < students.size() && skipped < first; ++cursor) {
+            skipped += !students[cursor].deleted;
+        }
+        OutputBuffer buffer(out);
+        renderStudentList(buffer, cursor, count);
+        return true;
+    }
+    if (command == "export") {
+        if (args.empty() || !exportStudentListing(string(args))) {
+            out << "Error: export needs a writable file name.\n";
+            return false;
         }
+        out << "Exported " << liveStudentCount() << " students to " << args << "\n";
+        return true;
+    }
+    if (command == "count") {
+        size_t kcetCount, managementCount;
+        countAdmissions(kcetCount, managementCount);
+        out << "KCET: " << kcetCount << " Management: " << managementCount << "\n";
+        return true;
+    }
+    if (command == "stats") {
+        OutputBuffer buffer(out);
+        renderAdmissionStatistics(buffer);
+        return true;
+    }
+    if (command == "describe") {
+        const StudentColumns& columns = studentColumns();
+        OutputBuffer buffer(out);
+        renderColumnStatistics(buffer, "Total Marks", computeColumnStatistics(columns.totalMarks));
+        renderColumnStatistics(buffer, "Expected Package (LPA)", computeColumnStatistics(columns.expectedPackage));
+        renderColumnStatistics(buffer, "Fees Paid (INR)", computeColumnStatistics(columns.feesPaid));
+        return true;
+    }
+    if (command == "generate") {
+        size_t count = 0;
+        if (!parseNumberField(args, count, "count", error) || count == 0) {
+            out << "Error: generate needs a positive count.\n";
+            return false;
+        }
+        return generateSampleStudents(count, out);
+    }
+    if (command == "save") {
+        // The save paths report on the console; the caller may be a server client
+        if (!compactStudentStore()) {
+            out << "Error: save failed; the journal still holds every change.\n";
+            return false;
+        }
+        out << "Saved\n";
+        return true;
+    }
+    out << "Error: unknown command '" << command << "'.\n";
+    return false;
+}
+
+int runBatchMode(istream& in) {
+    map<string, BatchOpStats> stats;
+    size_t failures = 0;
+    auto batchStart = chrono::steady_clock::now();
+    string line;
+    while (getline(in, line)) {
+        string_view text(line);
+        if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+        if (text.empty() || text[0] == '#') continue;
+        size_t space = text.find(' ');
+        string_view command = text.substr(0, space);
+        string_view args = space == string_view::npos ? string_view() : text.substr(space + 1);
+
+        auto start = chrono::steady_clock::now();
+        bool ok = executeLockedBatchCommand(command, args, cout);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
 
-        s.totalMarks = 300.0 + (rand() % 200) + (rand() % 100 / 100.0); // Marks between 300-499.99
-        s.rankObtained = 1 + (rand() % 5000); // Rank between 1-5000
-        s.expectedPackage = 3.0 + (rand() % 100) / 10.0; // Package between 3.0 and 12.9 LPA
+        BatchOpStats& op = stats[string(command)];
+        op.count++;
+        op.seconds += elapsed.count();
+        if (!ok) {
+            op.failed++;
+            failures++;
+        }
+    }
+    shutdownStudentStore(); // Same as choosing Exit from the menu
+    chrono::duration<double> total = chrono::steady_clock::now() - batchStart;
 
-        students.push_back(s);
+    cout << "\n--- Batch Summary ---\n";
+    cout << left << setw(10) << "Command" << right << setw(12) << "Ops" << setw(10) << "Failed"
+         << setw(14) << "Seconds" << setw(16) << "Ops/sec" << "\n";
+    for (const auto& entry : stats) {
+        const BatchOpStats& op = entry.second;
+        cout << left << setw(10) << entry.first << right << setw(12) << op.count << setw(10) << op.failed
+             << setw(14) << fixed << setprecision(6) << op.seconds
+             << setw(16) << setprecision(0) << (op.seconds > 0 ? op.count / op.seconds : 0.0) << "\n";
     }
-    cout << count << " sample students generated.\n";
-    saveStudentsToFile();
+    cout << "Total time (including final save): " << fixed << setprecision(3) << total.count() << " s\n";
+    return failures == 0 ? 0 : 2;
 }
 
-// Function to display course details and fees
-void displayCourseDetails() {
-    if (courses.empty()) {
-        cout << "\nNo engineering courses defined.\n";
-        return;
+// Commands that only read the store; the server runs these concurrently
+bool isReadOnlyBatchCommand(string_view command) {
+    static const string_view readOnly[] = {"search", "find", "query", "allot", "audit", "duplicates",
+                                           "top", "sort", "ranks", "marks", "list", "export", "count",
+                                           "stats", "describe"};
+    return find(begin(readOnly), end(readOnly), command) != end(readOnly);
+}
+
+// Runs a batch command under storeMutex: shared for queries, exclusive for
+// anything that changes records
+bool executeLockedBatchCommand(string_view command, string_view args, ostream& out) {
+    bool complete = loadShardsForBatchCommand(command, args);
+    if (isReadOnlyBatchCommand(command)) {
+        if (!complete) out << "Warning: a student shard could not be read; results leave out its students.\n";
+        shared_lock<shared_mutex> lock(storeMutex);
+        return executeBatchCommand(command, args, out);
     }
-    cout << "\n---- Engineering Courses and Fees ----\n";
-    cout << "------------------------------------------------------------------\n";
-    cout << left << setw(40) << "Course Name"
-         << left << setw(15) << "KCET Fees"
-         << left << setw(15) << "Mgmt Fees" << endl;
-    cout << "------------------------------------------------------------------\n";
-    for (const auto& c : courses) {
-        cout << left << setw(40) << c.courseName
-             << fixed << setprecision(2) << left << setw(15) << c.kcetFees
-             << fixed << setprecision(2) << left << setw(15) << c.managementFees << endl;
+    if (!complete) {
+        // Uniqueness checks and ID lookups would miss the students still on disk
+        out << "Error: " << command << " failed: a student shard could not be read.\n";
+        return false;
     }
-    cout << "------------------------------------------------------------------\n";
-    cout << "Management admission discount: " << fixed << setprecision(1) << MANAGEMENT_DISCOUNT_PERCENTAGE << "%\n";
-    cout << "------------------------------------------------------------------\n";
+    unique_lock<shared_mutex> lock(storeMutex);
+    return executeBatchCommand(command, args, out);
 }
 
-// Function to count admissions by type
-void countAdmissionsByType() {
-    if (students.empty()) {
-        cout << "\nNo student records to count.\n";
+// --- Server Mode ---
+// Serves batch commands to many clients over a Unix domain socket. Each
+// request is one command line; the reply is the command's output followed
+// by a status line, "OK" or "ERR". Queries run concurrently under a shared
+// lock on storeMutex, while changes take it exclusively and so run one at a
+// time. Requests sent back to back on one connection are answered in order.
+
+#ifdef _WIN32
+int runServer(const string&) {
+    cerr << "Error: server mode needs Unix domain sockets and is not available on Windows.\n";
+    return 1;
+}
+
+int runLoadGenerator(const string&, size_t, double, unsigned) {
+    cerr << "Error: the load generator needs Unix domain sockets and is not available on Windows.\n";
+    return 1;
+}
+#else
+volatile sig_atomic_t serverStopRequested = 0;
+
+void requestServerStop(int) {
+    serverStopRequested = 1;
+}
+
+// Connections still being served, so shutdown can close them and wait
+struct ServerClients {
+    mutex lock;
+    condition_variable idle;
+    unordered_set<int> fds;
+};
+
+bool sendAll(int fd, string_view data) {
+    while (!data.empty()) {
+        ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+// Runs one request under the lock that fits it and appends the reply
+void handleServerRequest(string_view line, string& reply) {
+    size_t space = line.find(' ');
+    string_view command = line.substr(0, space);
+    string_view args = space == string_view::npos ? string_view() : line.substr(space + 1);
+    ostringstream out;
+    bool ok = executeLockedBatchCommand(command, args, out);
+    reply += out.str();
+    reply += ok ? "OK\n" : "ERR\n";
+}
+
+void serveClient(int fd, ServerClients& clients) {
+    string pending, reply;
+    char buffer[64 * 1024];
+    while (true) {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) break;
+        pending.append(buffer, static_cast<size_t>(received));
+
+        // Answer every complete line in one write
+        reply.clear();
+        size_t start = 0, newline;
+        while ((newline = pending.find('\n', start)) != string::npos) {
+            string_view line(pending.data() + start, newline - start);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (!line.empty() && line[0] != '#') handleServerRequest(line, reply);
+            start = newline + 1;
+        }
+        pending.erase(0, start);
+        if (!reply.empty() && !sendAll(fd, reply)) break;
+    }
+    lock_guard<mutex> lock(clients.lock);
+    clients.fds.erase(fd);
+    close(fd);
+    clients.idle.notify_all();
+}
+
+int runServer(const string& socketPath) {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: socket path " << socketPath << " is too long.\n";
+        return 1;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        cerr << "Error: Could not create socket: " << strerror(errno) << "\n";
+        return 1;
+    }
+    // A socket file left by a server that crashed would make bind fail
+    error_code ec;
+    if (filesystem::is_socket(socketPath, ec)) filesystem::remove(socketPath, ec);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0) {
+        cerr << "Error: Could not listen on " << socketPath << ": " << strerror(errno) << "\n";
+        close(listener);
+        return 1;
+    }
+    signal(SIGINT, requestServerStop);
+    signal(SIGTERM, requestServerStop);
+    cout << "Serving " << storedStudentCount() << " students on " << socketPath << " (Ctrl+C to stop).\n";
+
+    ServerClients clients;
+    size_t accepted = 0;
+    while (!serverStopRequested) {
+        pollfd ready{listener, POLLIN, 0};
+        if (poll(&ready, 1, 200) <= 0) continue; // Timeout or EINTR: re-check the stop flag
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        {
+            lock_guard<mutex> lock(clients.lock);
+            clients.fds.insert(fd);
+        }
+        thread(serveClient, fd, ref(clients)).detach();
+        accepted++;
+    }
+    close(listener);
+    filesystem::remove(socketPath, ec);
+
+    // Wake every client blocked in recv and wait for their threads to finish
+    {
+        unique_lock<mutex> lock(clients.lock);
+        for (int fd : clients.fds) shutdown(fd, SHUT_RDWR);
+        clients.idle.wait(lock, [&clients] { return clients.fds.empty(); });
+    }
+    cout << "\nServer stopped after " << accepted << " connections. Saving data...\n";
+    shutdownStudentStore();
+    return 0;
+}
+
+// --- Load Generator ---
+
+struct LoadClientResult {
+    size_t reads = 0;
+    size_t writes = 0;
+    size_t failed = 0;
+    vector<double> latenciesMicros;
+    string error;
+};
+
+int connectToServer(const string& socketPath) {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) return -1;
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Sends one request and reads up to its status line. The reply body (without
+// the status line) is left in body; returns false if the connection failed.
+bool roundTrip(int fd, const string& request, string& pending, string& body, bool& ok) {
+    if (!sendAll(fd, request)) return false;
+    size_t scanned = 0;
+    while (true) {
+        size_t newline;
+        while ((newline = pending.find('\n', scanned)) != string::npos) {
+            size_t lineStart = scanned;
+            scanned = newline + 1;
+            string_view line(pending.data() + lineStart, newline - lineStart);
+            if (line == "OK" || line == "ERR") {
+                ok = line == "OK";
+                body.assign(pending, 0, lineStart);
+                pending.erase(0, scanned);
+                return true;
+            }
+        }
+        char buffer[64 * 1024];
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        pending.append(buffer, static_cast<size_t>(received));
+    }
+}
+
+// One simulated desk: a stream of lookups and searches mixed with marks
+// updates, each sent only after the previous reply arrived
+void runLoadClient(const string& socketPath, uint64_t seed, chrono::steady_clock::time_point deadline,
+                   unsigned writePercent, size_t studentCount, LoadClientResult& result) {
+    static const char* const prefixes[] = {"Ali", "Bob", "Cha", "Dia", "Eve", "Fra", "Gra", "Hei", "Iva", "Jud"};
+    int fd = connectToServer(socketPath);
+    if (fd < 0) {
+        result.error = strerror(errno);
         return;
     }
-    int kcetCount = 0;
-    int managementCount = 0;
-    for (const auto& s : students) {
-        if (s.admissionType == "KCET") {
-            kcetCount++;
-        } else if (s.admissionType == "Management") {
-            managementCount++;
+    FastRandom rng(seed);
+    string request, pending, body;
+    while (chrono::steady_clock::now() < deadline) {
+        string id = "SID" + to_string(FIRST_STUDENT_NUMBER + rng.below(studentCount));
+        bool write = rng.below(100) < writePercent;
+        if (write) {
+            request = "update " + id + " marks=" + to_string(300 + rng.below(200)) + "\n";
+        } else {
+            switch (rng.below(4)) {
+                case 0: request = "search " + id + "\n"; break;
+                case 1: request = "find " + string(prefixes[rng.below(10)]) + "\n"; break;
+                case 2: {
+                    uint64_t from = 1 + rng.below(5000);
+                    request = "ranks " + to_string(from) + " " + to_string(from + 100) + " 10\n";
+                    break;
+                }
+                default: request = "count\n"; break;
+            }
+        }
+        auto start = chrono::steady_clock::now();
+        bool ok = false;
+        if (!roundTrip(fd, request, pending, body, ok)) {
+            result.error = "connection closed by server";
+            break;
         }
+        chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+        result.latenciesMicros.push_back(elapsed.count());
+        (write ? result.writes : result.reads)++;
+        if (!ok) result.failed++; // e.g. a student deleted since the count was taken
+    }
+    close(fd);
+}
+
+int runLoadGenerator(const string& socketPath, size_t clientCount, double seconds, unsigned writePercent) {
+    // Student IDs to pick from: the store size, read once up front
+    int fd = connectToServer(socketPath);
+    if (fd < 0) {
+        cerr << "Error: Could not connect to " << socketPath << ": " << strerror(errno) << "\n";
+        return 1;
     }
-    cout << "\n--- Admission Statistics ---\n";
-    cout << "Total students admitted through KCET: " << kcetCount << endl;
-    cout << "Total students admitted through Management: " << managementCount << endl;
-    cout << "----------------------------\n";
-}
\ No newline at end of file
+    string pending, body;
+    bool ok = false;
+    size_t kcetCount = 0, managementCount = 0;
+    if (!roundTrip(fd, "count\n", pending, body, ok) || !ok ||
+        sscanf(body.c_str(), "KCET: %zu Management: %zu", &kcetCount, &managementCount) != 2) {
+        cerr << "Error: Server did not answer the count request.\n";
+        close(fd);
+        return 1;
+    }
+    close(fd);
+    size_t studentCount = max<size_t>(1, kcetCount + managementCount);
+
+    cout << "Load test: " << clientCount << " clients, " << seconds << " s, " << writePercent
+         << "% writes, " << studentCount << " students\n";
+    vector<LoadClientResult> results(clientCount);
+    vector<thread> workers;
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
+    for (size_t i = 0; i < clientCount; ++i) {
+        workers.emplace_back(runLoadClient, cref(socketPath), 0x5eed + i, deadline, writePercent, studentCount, ref(results[i]));
+    }
+    for (auto& w : workers) w.join();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    size_t reads = 0, writes = 0, failed = 0;
+    vector<double> latencies;
+    for (const auto& r : results) {
+        if (!r.error.empty()) cerr << "Warning: a client stopped early: " << r.error << "\n";
+        reads += r.reads;
+        writes += r.writes;
+        failed += r.failed;
+        latencies.insert(latencies.end(), r.latenciesMicros.begin(), r.latenciesMicros.end());
+    }
+    if (latencies.empty()) {
+        cerr << "Error: No requests completed.\n";
+        return 1;
+    }
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) { return latencies[min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))]; };
+    cout << fixed << setprecision(0);
+    cout << "Requests: " << reads + writes << " (" << reads << " reads, " << writes << " writes, "
+         << failed << " answered ERR)\n";
+    cout << "Throughput: " << (reads + writes) / elapsed.count() << " ops/sec\n";
+    cout << setprecision(1) << "Latency (us): p50 " << percentile(0.50) << "  p99 " << percentile(0.99)
+         << "  max " << latencies.back() << "\n";
+    return 0;
+}
+#endif
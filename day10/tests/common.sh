@@ -0,0 +1,38 @@
+# Shared setup for the crash-recovery scripts in this directory. Builds ex2
+# unless EX2 names a binary already, and makes a scratch directory that is
+# removed on exit. Source it with bash; every script stops at its first failure.
+set -euo pipefail
+
+TESTS_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+SOURCE_DIR=$(dirname "$TESTS_DIR")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+if [ -z "${EX2:-}" ]; then
+    EX2="$WORK/ex2"
+    ${CXX:-g++} -std=c++17 -O2 -pthread -o "$EX2" "$SOURCE_DIR/ex2.cpp"
+fi
+
+# Creates $WORK/<name> holding the sample courses.txt and students.txt
+fresh_store() {
+    mkdir "$WORK/$1"
+    cp "$SOURCE_DIR/courses.txt" "$SOURCE_DIR/students.txt" "$WORK/$1"
+}
+
+# Runs ex2 with the given arguments inside store directory $1
+run_in() {
+    local dir=$1
+    shift
+    (cd "$WORK/$dir" && "$EX2" "$@")
+}
+
+# Runs the batch commands on stdin in store directory $1 and prints only
+# what the commands printed: no load and save messages, no timing summary
+batch_output() {
+    run_in "$1" --batch - 2>&1 | sed '/--- Batch Summary ---/,$d' | grep -v 'successfully' || true
+}
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
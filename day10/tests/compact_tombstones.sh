@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+# Deleting a quarter of the students compacts their tombstones away in the
+# middle of the batch. Lookups, listings and later changes must then match a
+# store that never held the deleted students.
+. "$(dirname "$0")/common.sh"
+
+FIRST_DELETES="SID1001 SID1002 SID1004 SID1006"
+MORE_DELETES="SID1008 SID1010 SID1013 SID1020" # The 8th of 30 crosses TOMBSTONE_COMPACT_PERCENT
+LAST_DELETE="SID1025"                          # After compaction
+CHECKS='search SID1030
+search SID1013
+find Grace
+sort
+list 5 10
+update SID1012 name=Liam Updated
+search SID1012
+top 3'
+
+fresh_store compacted
+{
+    for id in $FIRST_DELETES; do echo "delete $id"; done
+    for id in $MORE_DELETES; do echo "delete $id"; done
+    echo "delete $LAST_DELETE"
+    echo "$CHECKS"
+} | batch_output compacted | grep -v '^Deleted' > "$WORK/compacted.out"
+
+fresh_store filtered
+for id in $FIRST_DELETES $MORE_DELETES $LAST_DELETE; do
+    grep -v ",$id," "$WORK/filtered/students.txt" > "$WORK/filtered/students.tmp"
+    mv "$WORK/filtered/students.tmp" "$WORK/filtered/students.txt"
+done
+[ "$(wc -l < "$WORK/filtered/students.txt")" = 21 ] || fail "fixture students.txt no longer has the expected IDs"
+echo "$CHECKS" | batch_output filtered > "$WORK/filtered.out"
+
+grep -q 'Liam Updated' "$WORK/compacted.out" || fail "update after compaction not visible"
+diff -u "$WORK/filtered.out" "$WORK/compacted.out" || fail "compacted store differs from one without the deleted students"
+
+# The saved store must hold the same students in the same order too
+run_in compacted --export listing.txt > /dev/null
+run_in filtered --export listing.txt > /dev/null
+cmp -s "$WORK/filtered/listing.txt" "$WORK/compacted/listing.txt" || fail "saved store differs after compaction"
+echo "PASS: compact_tombstones"
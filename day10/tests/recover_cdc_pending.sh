@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+# A crash between saving a snapshot and publishing its staged change events
+# leaves them in students.cdc.pending. The next start publishes them if the
+# snapshot was saved, and drops them if it was not.
+. "$(dirname "$0")/common.sh"
+
+fresh_store saved
+printf 'count\n' | run_in saved --batch - > /dev/null # Creates students.cdc
+cp "$WORK/saved/students.cdc" "$WORK/before.cdc"
+cp "$WORK/saved/students.txt" "$WORK/before.txt"
+
+# Generated students are saved by the snapshot alone, their events staged
+printf 'generate 5\n' | run_in saved --batch - > /dev/null
+cp "$WORK/saved/students.cdc" "$WORK/after.cdc"
+BEFORE_SIZE=$(wc -c < "$WORK/before.cdc")
+[ "$(wc -c < "$WORK/after.cdc")" -gt "$BEFORE_SIZE" ] || fail "generate published no events"
+
+# Snapshot saved, events still staged
+cp -r "$WORK/saved" "$WORK/unsaved"
+tail -c +$((BEFORE_SIZE + 1)) "$WORK/after.cdc" > "$WORK/saved/students.cdc.pending"
+cp "$WORK/before.cdc" "$WORK/saved/students.cdc"
+run_in saved --export listing.txt | grep -q 'Published 5 change event' || fail "staged events not reported as published"
+[ ! -e "$WORK/saved/students.cdc.pending" ] || fail "students.cdc.pending left behind after publishing"
+cmp -s "$WORK/after.cdc" "$WORK/saved/students.cdc" || fail "published events differ from the ones first written"
+
+# Snapshot not saved: the old records are still there, the events must go
+tail -c +$((BEFORE_SIZE + 1)) "$WORK/after.cdc" > "$WORK/unsaved/students.cdc.pending"
+cp "$WORK/before.cdc" "$WORK/unsaved/students.cdc"
+cp "$WORK/before.txt" "$WORK/unsaved/students.txt"
+run_in unsaved --export listing.txt > /dev/null
+[ ! -e "$WORK/unsaved/students.cdc.pending" ] || fail "students.cdc.pending kept for a snapshot that was never saved"
+cmp -s "$WORK/before.cdc" "$WORK/unsaved/students.cdc" || fail "events of an unsaved snapshot were published"
+echo "PASS: recover_cdc_pending"
@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+# A journal left over from a crash is replayed over the snapshot it belongs
+# to, both when the crash came before compaction (snapshot older than the
+# journal) and when it came between saving the snapshot and resetting the
+# journal (snapshot already holding every entry). Both must give the same
+# store, in the CSV and in the binary snapshot format.
+. "$(dirname "$0")/common.sh"
+
+# SID1003 is updated, SID1005 deleted; SID1007 moves to Mechanical Engineering
+# just before the course is withdrawn, and SID2001 joins it afterwards
+write_journal() {
+    {
+        echo 'A,Zed 100,9000000001,zed@example.com,"Street 1, City 2, PIN 560001",O+,SID2000,Civil Engineering,KCET,450.00,120,6.00,90000.00'
+        grep ',SID1003,' "$SOURCE_DIR/students.txt" | sed 's/^Charlie 457,/U,Charlie Updated,/; s/,120000.00$/,121000.00/'
+        echo 'D,SID1005'
+        grep ',SID1007,' "$SOURCE_DIR/students.txt" | sed 's/^/U,/; s/,Civil Engineering,/,Mechanical Engineering,/'
+        echo 'W,Mechanical Engineering'
+        echo 'A,Yan 200,9000000002,yan@example.com,Street 3,B+,SID2001,Mechanical Engineering,KCET,410.00,900,5.00,100000.00'
+    } > "$WORK/$1/students.journal"
+}
+
+for format in csv snap; do
+    older=$format-older
+    newer=$format-newer
+    fresh_store "$older"
+    if [ "$format" = snap ]; then
+        run_in "$older" --csv-to-snap > /dev/null
+        rm "$WORK/$older/students.txt"
+    fi
+    cp -r "$WORK/$older" "$WORK/$newer"
+    write_journal "$older"
+    run_in "$older" --export expected.txt > /dev/null
+
+    listing="$WORK/$older/expected.txt"
+    grep -q 'SID2000' "$listing" || fail "$format: added student SID2000 missing"
+    grep -q 'SID2001' "$listing" || fail "$format: SID2001, added after the withdrawal, missing"
+    grep -q 'Charlie Updated' "$listing" || fail "$format: update of SID1003 not applied"
+    ! grep -q 'SID1005' "$listing" || fail "$format: deleted student SID1005 still listed"
+    ! grep -q 'SID1007' "$listing" || fail "$format: SID1007 should have been withdrawn with its new course"
+    [ "$(grep -c 'Mechanical Engineering' "$listing")" = 1 ] || fail "$format: withdrawn course should only hold SID2001"
+
+    # Fold the same journal into the snapshot, then leave it behind again as
+    # if the process died before resetting it
+    write_journal "$newer"
+    run_in "$newer" --batch /dev/null > /dev/null
+    [ ! -s "$WORK/$newer/students.journal" ] || fail "$format: journal not reset by compaction"
+    write_journal "$newer"
+    run_in "$newer" --export replayed.txt > /dev/null
+    cmp -s "$listing" "$WORK/$newer/replayed.txt" ||
+        fail "$format: replaying over the newer snapshot changed the store"
+done
+echo "PASS: replay_journal"
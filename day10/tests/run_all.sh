@@ -0,0 +1,15 @@
+#!/usr/bin/env bash
+# Runs every crash-recovery script here against one build of ex2
+set -euo pipefail
+TESTS_DIR=$(cd "$(dirname "$0")" && pwd)
+if [ -z "${EX2:-}" ]; then
+    BUILD=$(mktemp -d)
+    trap 'rm -rf "$BUILD"' EXIT
+    export EX2="$BUILD/ex2"
+    ${CXX:-g++} -std=c++17 -O2 -pthread -o "$EX2" "$TESTS_DIR/../ex2.cpp"
+fi
+status=0
+for script in replay_journal.sh recover_cdc_pending.sh compact_tombstones.sh; do
+    bash "$TESTS_DIR/$script" || status=1
+done
+exit $status